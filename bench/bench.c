@@ -0,0 +1,420 @@
+/*
+ * console-bench: micro-benchmarks for the core console API.
+ *
+ * Every benchmark is run for each font and view size and repeats its
+ * batch until the minimum run time has elapsed. Results are written to
+ * stdout as a single JSON document.
+ *
+ * usage: console-bench [-t seconds] [-f font_id] [-s WIDTHxHEIGHT]...
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_MAX_SIZES 16
+
+typedef struct {
+    unsigned width;
+    unsigned height;
+} bench_size_t;
+
+static const bench_size_t g_default_sizes[] = {
+    { 640, 480 },
+    { 1280, 720 },
+    { 1920, 1080 }
+};
+
+static double g_min_time = 0.25;
+static int g_first_result = 1;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t bench_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void bench_report(const char * name, font_id_t font, const bench_size_t * size,
+        console_t console, unsigned long long ops, double seconds, const char * unit) {
+    printf("%s\n    {\"benchmark\": \"%s\", \"font\": \"%s\", \"view_width\": %u, \"view_height\": %u, "
+            "\"columns\": %u, \"rows\": %u, \"ops\": %llu, \"seconds\": %.6f, \"%s\": %.1f, \"ns_per_op\": %.2f}",
+            g_first_result ? "" : ",", name, console_fonts[font].font_name, size->width, size->height,
+            console_get_width(console), console_get_height(console), ops, seconds, unit,
+            seconds > 0 ? ops / seconds : 0.0, ops > 0 ? seconds * 1e9 / ops : 0.0);
+    g_first_result = 0;
+}
+
+/* printable text with a line feed roughly every 72 characters, so the run scrolls */
+static void bench_print_char(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned long long ops = 0;
+    unsigned column = 0;
+    unsigned char c = ' ';
+    double start = bench_now(), elapsed;
+    do {
+        unsigned i;
+        for(i = 0; i < 4096; ++i) {
+            if(++column == 72) {
+                console_print_char(console, '\n');
+                column = 0;
+            } else {
+                console_print_char(console, c);
+                if(++c > '~')
+                    c = ' ';
+            }
+        }
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("print_char", font, size, console, ops, elapsed, "chars_per_sec");
+}
+
+static void bench_write(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned char buf[4096];
+    unsigned i;
+    for(i = 0; i < sizeof(buf); ++i)
+        buf[i] = (i % 72 == 71) ? '\n' : (unsigned char)(' ' + i % 95);
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        console_write(console, buf, sizeof(buf));
+        ops += sizeof(buf);
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("write", font, size, console, ops, elapsed, "chars_per_sec");
+}
+
+/* the write benchmark's text passed through the input queue on one thread */
+static void bench_enqueue_drain(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned char buf[4096];
+    unsigned i;
+    for(i = 0; i < sizeof(buf); ++i)
+        buf[i] = (i % 72 == 71) ? '\n' : (unsigned char)(' ' + i % 95);
+    console_set_queue_size(console, 65536);
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        size_t n = console_enqueue(console, buf, sizeof(buf));
+        console_drain(console, n);
+        ops += n;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    console_set_queue_size(console, 0);
+    bench_report("enqueue_drain", font, size, console, ops, elapsed, "chars_per_sec");
+}
+
+/* the write benchmark's text fed to a group of deferred consoles, drained and flushed by its pool */
+#define BENCH_GROUP_CONSOLES 32
+
+static void bench_group(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned char buf[4096];
+    console_t consoles[BENCH_GROUP_CONSOLES];
+    unsigned i, n = 0;
+    for(i = 0; i < sizeof(buf); ++i)
+        buf[i] = (i % 72 == 71) ? '\n' : (unsigned char)(' ' + i % 95);
+    console_group_t group = console_group_alloc(0);
+    if(!group)
+        return;
+    for(i = 0; i < BENCH_GROUP_CONSOLES; ++i) {
+        consoles[n] = console_alloc(size->width, size->height, font);
+        if(!consoles[n])
+            continue;
+        console_set_queue_size(consoles[n], 65536);
+        console_set_deferred_updates(consoles[n], true);
+        console_group_add(group, consoles[n], NULL, NULL);
+        ++n;
+    }
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        for(i = 0; i < n; ++i)
+            ops += console_enqueue(consoles[i], buf, sizeof(buf));
+        console_group_schedule_all(group);
+        console_group_wait(group);
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    console_group_free(group);
+    for(i = 0; i < n; ++i)
+        console_free(consoles[i]);
+    bench_report("group", font, size, console, ops, elapsed, "chars_per_sec");
+}
+
+static void bench_scroll_lines(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        unsigned i;
+        for(i = 0; i < 256; ++i)
+            console_scroll_lines(console, 1);
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("scroll_lines", font, size, console, ops, elapsed, "lines_per_sec");
+}
+
+static void bench_clear(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        unsigned i;
+        for(i = 0; i < 16; ++i)
+            console_clear(console);
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("clear", font, size, console, ops, elapsed, "clears_per_sec");
+}
+
+static void bench_set_char_attr(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned w = console_get_width(console);
+    unsigned h = console_get_height(console);
+    unsigned x[1024], y[1024];
+    uint32_t state = 0x9e3779b9u;
+    unsigned i;
+    for(i = 0; i < 1024; ++i) {
+        x[i] = bench_random(&state) % w;
+        y[i] = bench_random(&state) % h;
+    }
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        for(i = 0; i < 1024; ++i)
+            console_set_character_and_attribute_at(console, x[i], y[i], (unsigned char)i, (unsigned char)(i >> 2));
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("set_character_and_attribute_at", font, size, console, ops, elapsed, "cells_per_sec");
+}
+
+/* one entry animated, each change scans the grid for cells drawn in it */
+static void bench_set_palette(console_t console, font_id_t font, const bench_size_t * size) {
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    console_get_palette(console, palette);
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        unsigned i;
+        for(i = 0; i < 64; ++i) {
+            ++palette[CONSOLE_LIGHT_CYAN].b;
+            console_set_palette(console, palette);
+        }
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("set_palette", font, size, console, ops, elapsed, "changes_per_sec");
+}
+
+/* one cell changed through the raw buffer per diff, so the compare dominates */
+static void bench_diff(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned cells = console_get_width(console) * console_get_height(console);
+    if(cells == 0)
+        return;
+    console_span_t * spans = malloc(console_get_height(console) * sizeof(console_span_t));
+    if(!spans)
+        return;
+    console_diff(console, spans);
+    uint32_t seed = 1;
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        unsigned i;
+        for(i = 0; i < 64; ++i) {
+            console_get_raw_buffer(console)[bench_random(&seed) % cells] ^= 0x0100;
+            console_diff(console, spans);
+        }
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report("diff", font, size, console, ops, elapsed, "diffs_per_sec");
+    free(spans);
+}
+
+/* a line of output per snapshot, so each publish copies a row or two */
+static void bench_snapshot_publish(console_t console, font_id_t font, const bench_size_t * size) {
+    unsigned char line[73];
+    unsigned i;
+    for(i = 0; i < sizeof(line); ++i)
+        line[i] = i == sizeof(line) - 1 ? '\n' : (unsigned char)(' ' + i % 95);
+    console_set_snapshots(console, true);
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        for(i = 0; i < 64; ++i) {
+            console_write(console, line, sizeof(line));
+            console_snapshot_publish(console);
+            console_snapshot_release(console, console_snapshot_acquire(console));
+        }
+        ops += i;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    console_set_snapshots(console, false);
+    bench_report("snapshot_publish", font, size, console, ops, elapsed, "snapshots_per_sec");
+}
+
+static void bench_render(console_t console, font_id_t font, const bench_size_t * size, const char * name,
+        console_pixel_format format, unsigned bytes_per_pixel) {
+    unsigned pw = console_get_width(console) * console_get_char_width(console);
+    unsigned ph = console_get_height(console) * console_get_char_height(console);
+    size_t stride = bytes_per_pixel ? pw * bytes_per_pixel : (pw + 7) / 8;
+    void * pixels = malloc(stride * (ph ? ph : 1));
+    if(!pixels)
+        return;
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        console_render(console, pixels, stride, format);
+        ++ops;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report(name, font, size, console, ops, elapsed, "frames_per_sec");
+    free(pixels);
+}
+
+/* XRGB8888 in bands on a pool with a thread per CPU, the whole frame or one rewritten line per frame */
+static void bench_render_bands(console_t console, font_id_t font, const bench_size_t * size, const char * name,
+        bool damage) {
+    unsigned pw = console_get_width(console) * console_get_char_width(console);
+    unsigned ph = console_get_height(console) * console_get_char_height(console);
+    size_t stride = pw * 4;
+    void * pixels = malloc(stride * (ph ? ph : 1));
+    console_group_t group = console_group_alloc(0);
+    if(!pixels || !group) {
+        free(pixels);
+        console_group_free(group);
+        return;
+    }
+    unsigned char line[72];
+    unsigned i;
+    for(i = 0; i < sizeof(line); ++i)
+        line[i] = (unsigned char)(' ' + i % 95);
+    /* short of the last column, so the line never wraps and scrolls */
+    size_t len = console_get_width(console) > sizeof(line) ? sizeof(line) : console_get_width(console) - 1;
+    unsigned rows = console_get_height(console);
+    console_set_deferred_updates(console, damage);
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        if(damage && rows > 0) {
+            console_cursor_goto_xy(console, 0, ops % rows);
+            console_write(console, line, len);
+        }
+        console_render_bands(console, group, pixels, stride, CONSOLE_PIXEL_XRGB8888);
+        console_flush(console);
+        ++ops;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    console_set_deferred_updates(console, false);
+    bench_report(name, font, size, console, ops, elapsed, "frames_per_sec");
+    console_group_free(group);
+    free(pixels);
+}
+
+static void bench_render_yuv(console_t console, font_id_t font, const bench_size_t * size, const char * name,
+        console_yuv_format format) {
+    size_t pw = console_get_width(console) * console_get_char_width(console);
+    size_t ph = console_get_height(console) * console_get_char_height(console);
+    size_t cw = (pw + 1) / 2, ch = (ph + 1) / 2;
+    unsigned char * planes_buf = malloc(pw * ph + cw * ch * 2 + 1);
+    if(!planes_buf)
+        return;
+    console_yuv_planes_t planes = {
+        .y = planes_buf, .y_stride = pw,
+        .u = planes_buf + pw * ph, .u_stride = format == CONSOLE_YUV_NV12 ? cw * 2 : cw,
+        .v = planes_buf + pw * ph + cw * ch, .v_stride = cw
+    };
+    unsigned long long ops = 0;
+    double start = bench_now(), elapsed;
+    do {
+        console_render_yuv(console, &planes, format);
+        ++ops;
+        elapsed = bench_now() - start;
+    } while(elapsed < g_min_time);
+    bench_report(name, font, size, console, ops, elapsed, "frames_per_sec");
+    free(planes_buf);
+}
+
+static void bench_run(font_id_t font, const bench_size_t * size) {
+    console_t console = console_alloc(size->width, size->height, font);
+    if(!console)
+        return;
+    bench_print_char(console, font, size);
+    bench_write(console, font, size);
+    bench_enqueue_drain(console, font, size);
+    bench_group(console, font, size);
+    bench_scroll_lines(console, font, size);
+    bench_clear(console, font, size);
+    bench_set_char_attr(console, font, size);
+    bench_set_palette(console, font, size);
+    bench_snapshot_publish(console, font, size);
+    bench_diff(console, font, size);
+    bench_render(console, font, size, "render", CONSOLE_PIXEL_XRGB8888, 4);
+    bench_render(console, font, size, "render_rgb565", CONSOLE_PIXEL_RGB565, 2);
+    bench_render(console, font, size, "render_index8", CONSOLE_PIXEL_INDEX8, 1);
+    /* 0 bytes per pixel sizes the buffer for 1bpp */
+    bench_render(console, font, size, "render_mono1", CONSOLE_PIXEL_MONO1, 0);
+    bench_render_bands(console, font, size, "render_bands", false);
+    bench_render_bands(console, font, size, "render_bands_damage", true);
+    bench_render_yuv(console, font, size, "render_i420", CONSOLE_YUV_I420);
+    bench_render_yuv(console, font, size, "render_nv12", CONSOLE_YUV_NV12);
+    /* glyph expansion on every cell, from byte padded and from packed glyphs */
+    size_t cache_size = console_get_tile_cache_size(console);
+    console_set_tile_cache_size(console, 0);
+    bench_render(console, font, size, "render_uncached", CONSOLE_PIXEL_XRGB8888, 4);
+    console_set_packed_glyphs(console, true);
+    bench_render(console, font, size, "render_packed", CONSOLE_PIXEL_XRGB8888, 4);
+    console_set_packed_glyphs(console, false);
+    console_set_tile_cache_size(console, cache_size);
+    console_free(console);
+}
+
+static void bench_usage(const char * name) {
+    fprintf(stderr, "usage: %s [-t seconds] [-f font_id] [-s WIDTHxHEIGHT]...\n", name);
+    exit(2);
+}
+
+int main(int argc, char ** argv) {
+    bench_size_t sizes[BENCH_MAX_SIZES];
+    unsigned nsizes = 0;
+    int only_font = -1;
+    int i;
+    for(i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+            g_min_time = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "-f") && i + 1 < argc) {
+            only_font = atoi(argv[++i]);
+            if(only_font < 0 || only_font >= CONSOLE_NUM_FONTS)
+                bench_usage(argv[0]);
+        } else if(!strcmp(argv[i], "-s") && i + 1 < argc && nsizes < BENCH_MAX_SIZES) {
+            if(sscanf(argv[++i], "%ux%u", &sizes[nsizes].width, &sizes[nsizes].height) != 2)
+                bench_usage(argv[0]);
+            ++nsizes;
+        } else {
+            bench_usage(argv[0]);
+        }
+    }
+    if(nsizes == 0) {
+        nsizes = sizeof(g_default_sizes) / sizeof(g_default_sizes[0]);
+        memcpy(sizes, g_default_sizes, sizeof(g_default_sizes));
+    }
+
+    printf("{\n  \"min_time\": %.3f,\n  \"results\": [", g_min_time);
+    int font;
+    for(font = 0; font < CONSOLE_NUM_FONTS; ++font) {
+        if(only_font >= 0 && font != only_font)
+            continue;
+        unsigned s;
+        for(s = 0; s < nsizes; ++s)
+            bench_run((font_id_t)font, &sizes[s]);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,678 @@
+#include "console.h"
+#include "console-private.h"
+#include "simd.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * VT100/xterm escape sequence parser after Paul Williams' DEC compatible
+ * state machine (http://vt100.net/emu/dec_ansi_parser). Every byte is one
+ * lookup in g_ansi_table giving the action to run and the next state.
+ * DCS, OSC, SOS, PM and APC strings are recognised and skipped. Bytes
+ * 0x80-0xFF are glyphs of the CP437 fonts, so C1 controls are not decoded.
+ */
+
+enum {
+    ANSI_STATE_GROUND,
+    ANSI_STATE_ESCAPE,
+    ANSI_STATE_ESCAPE_INTERMEDIATE,
+    ANSI_STATE_CSI_ENTRY,
+    ANSI_STATE_CSI_PARAM,
+    ANSI_STATE_CSI_INTERMEDIATE,
+    ANSI_STATE_CSI_IGNORE,
+    ANSI_STATE_DCS_ENTRY,
+    ANSI_STATE_DCS_PARAM,
+    ANSI_STATE_DCS_INTERMEDIATE,
+    ANSI_STATE_DCS_PASSTHROUGH,
+    ANSI_STATE_DCS_IGNORE,
+    ANSI_STATE_OSC_STRING,
+    ANSI_STATE_SOS_PM_APC_STRING,
+    ANSI_STATE_COUNT
+};
+
+enum {
+    ANSI_ACTION_NONE,
+    ANSI_ACTION_PRINT,
+    ANSI_ACTION_EXECUTE,
+    ANSI_ACTION_CLEAR,
+    ANSI_ACTION_COLLECT,
+    ANSI_ACTION_PARAM,
+    ANSI_ACTION_ESC_DISPATCH,
+    ANSI_ACTION_CSI_DISPATCH
+};
+
+#define T(action, state) ((ANSI_ACTION_##action << 4) | ANSI_STATE_##state)
+
+/* transitions shared by all states */
+#define ANSI_ANYWHERE \
+    [0x18] = T(EXECUTE, GROUND), \
+    [0x1a] = T(EXECUTE, GROUND), \
+    [0x1b] = T(CLEAR, ESCAPE)
+
+/* C0 controls other than CAN, SUB and ESC */
+#define ANSI_C0(action, state) \
+    [0x00 ... 0x17] = T(action, state), \
+    [0x19] = T(action, state), \
+    [0x1c ... 0x1f] = T(action, state)
+
+#define ANSI_HIGH(state) \
+    [0x80 ... 0xff] = T(NONE, state)
+
+static const unsigned char g_ansi_table[ANSI_STATE_COUNT][256] = {
+    [ANSI_STATE_GROUND] = {
+        ANSI_C0(EXECUTE, GROUND),
+        [0x20 ... 0xff] = T(PRINT, GROUND),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_ESCAPE] = {
+        ANSI_C0(EXECUTE, ESCAPE),
+        [0x20 ... 0x2f] = T(COLLECT, ESCAPE_INTERMEDIATE),
+        [0x30 ... 0x4f] = T(ESC_DISPATCH, GROUND),
+        [0x50] = T(CLEAR, DCS_ENTRY),
+        [0x51 ... 0x57] = T(ESC_DISPATCH, GROUND),
+        [0x58] = T(NONE, SOS_PM_APC_STRING),
+        [0x59 ... 0x5a] = T(ESC_DISPATCH, GROUND),
+        [0x5b] = T(CLEAR, CSI_ENTRY),
+        [0x5c] = T(ESC_DISPATCH, GROUND),
+        [0x5d] = T(NONE, OSC_STRING),
+        [0x5e ... 0x5f] = T(NONE, SOS_PM_APC_STRING),
+        [0x60 ... 0x7e] = T(ESC_DISPATCH, GROUND),
+        [0x7f] = T(NONE, ESCAPE),
+        ANSI_HIGH(ESCAPE),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_ESCAPE_INTERMEDIATE] = {
+        ANSI_C0(EXECUTE, ESCAPE_INTERMEDIATE),
+        [0x20 ... 0x2f] = T(COLLECT, ESCAPE_INTERMEDIATE),
+        [0x30 ... 0x7e] = T(ESC_DISPATCH, GROUND),
+        [0x7f] = T(NONE, ESCAPE_INTERMEDIATE),
+        ANSI_HIGH(ESCAPE_INTERMEDIATE),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_CSI_ENTRY] = {
+        ANSI_C0(EXECUTE, CSI_ENTRY),
+        [0x20 ... 0x2f] = T(COLLECT, CSI_INTERMEDIATE),
+        [0x30 ... 0x39] = T(PARAM, CSI_PARAM),
+        [0x3a] = T(NONE, CSI_IGNORE),
+        [0x3b] = T(PARAM, CSI_PARAM),
+        [0x3c ... 0x3f] = T(COLLECT, CSI_PARAM),
+        [0x40 ... 0x7e] = T(CSI_DISPATCH, GROUND),
+        [0x7f] = T(NONE, CSI_ENTRY),
+        ANSI_HIGH(CSI_ENTRY),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_CSI_PARAM] = {
+        ANSI_C0(EXECUTE, CSI_PARAM),
+        [0x20 ... 0x2f] = T(COLLECT, CSI_INTERMEDIATE),
+        [0x30 ... 0x39] = T(PARAM, CSI_PARAM),
+        [0x3a] = T(NONE, CSI_IGNORE),
+        [0x3b] = T(PARAM, CSI_PARAM),
+        [0x3c ... 0x3f] = T(NONE, CSI_IGNORE),
+        [0x40 ... 0x7e] = T(CSI_DISPATCH, GROUND),
+        [0x7f] = T(NONE, CSI_PARAM),
+        ANSI_HIGH(CSI_PARAM),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_CSI_INTERMEDIATE] = {
+        ANSI_C0(EXECUTE, CSI_INTERMEDIATE),
+        [0x20 ... 0x2f] = T(COLLECT, CSI_INTERMEDIATE),
+        [0x30 ... 0x3f] = T(NONE, CSI_IGNORE),
+        [0x40 ... 0x7e] = T(CSI_DISPATCH, GROUND),
+        [0x7f] = T(NONE, CSI_INTERMEDIATE),
+        ANSI_HIGH(CSI_INTERMEDIATE),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_CSI_IGNORE] = {
+        ANSI_C0(EXECUTE, CSI_IGNORE),
+        [0x20 ... 0x3f] = T(NONE, CSI_IGNORE),
+        [0x40 ... 0x7e] = T(NONE, GROUND),
+        [0x7f] = T(NONE, CSI_IGNORE),
+        ANSI_HIGH(CSI_IGNORE),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_DCS_ENTRY] = {
+        ANSI_C0(NONE, DCS_ENTRY),
+        [0x20 ... 0x2f] = T(COLLECT, DCS_INTERMEDIATE),
+        [0x30 ... 0x39] = T(PARAM, DCS_PARAM),
+        [0x3a] = T(NONE, DCS_IGNORE),
+        [0x3b] = T(PARAM, DCS_PARAM),
+        [0x3c ... 0x3f] = T(COLLECT, DCS_PARAM),
+        [0x40 ... 0x7e] = T(NONE, DCS_PASSTHROUGH),
+        [0x7f] = T(NONE, DCS_ENTRY),
+        ANSI_HIGH(DCS_ENTRY),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_DCS_PARAM] = {
+        ANSI_C0(NONE, DCS_PARAM),
+        [0x20 ... 0x2f] = T(COLLECT, DCS_INTERMEDIATE),
+        [0x30 ... 0x39] = T(PARAM, DCS_PARAM),
+        [0x3a] = T(NONE, DCS_IGNORE),
+        [0x3b] = T(PARAM, DCS_PARAM),
+        [0x3c ... 0x3f] = T(NONE, DCS_IGNORE),
+        [0x40 ... 0x7e] = T(NONE, DCS_PASSTHROUGH),
+        [0x7f] = T(NONE, DCS_PARAM),
+        ANSI_HIGH(DCS_PARAM),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_DCS_INTERMEDIATE] = {
+        ANSI_C0(NONE, DCS_INTERMEDIATE),
+        [0x20 ... 0x2f] = T(COLLECT, DCS_INTERMEDIATE),
+        [0x30 ... 0x3f] = T(NONE, DCS_IGNORE),
+        [0x40 ... 0x7e] = T(NONE, DCS_PASSTHROUGH),
+        [0x7f] = T(NONE, DCS_INTERMEDIATE),
+        ANSI_HIGH(DCS_INTERMEDIATE),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_DCS_PASSTHROUGH] = {
+        ANSI_C0(NONE, DCS_PASSTHROUGH),
+        [0x20 ... 0x7f] = T(NONE, DCS_PASSTHROUGH),
+        ANSI_HIGH(DCS_PASSTHROUGH),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_DCS_IGNORE] = {
+        ANSI_C0(NONE, DCS_IGNORE),
+        [0x20 ... 0x7f] = T(NONE, DCS_IGNORE),
+        ANSI_HIGH(DCS_IGNORE),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_OSC_STRING] = {
+        ANSI_C0(NONE, OSC_STRING),
+        [0x07] = T(NONE, GROUND), /* xterm accepts BEL as string terminator */
+        [0x20 ... 0x7f] = T(NONE, OSC_STRING),
+        ANSI_HIGH(OSC_STRING),
+        ANSI_ANYWHERE
+    },
+    [ANSI_STATE_SOS_PM_APC_STRING] = {
+        ANSI_C0(NONE, SOS_PM_APC_STRING),
+        [0x20 ... 0x7f] = T(NONE, SOS_PM_APC_STRING),
+        ANSI_HIGH(SOS_PM_APC_STRING),
+        ANSI_ANYWHERE
+    },
+};
+
+#undef T
+
+/* ANSI colour order to palette index */
+static const unsigned char g_ansi_colors[8] = {
+    CONSOLE_BLACK, CONSOLE_RED, CONSOLE_GREEN, CONSOLE_BROWN,
+    CONSOLE_BLUE, CONSOLE_MAGENTA, CONSOLE_CYAN, CONSOLE_LIGHT_GRAY
+};
+
+#define SGR_BOLD 1
+#define SGR_REVERSE 2
+
+static void console_ansi_apply_sgr(console_t console) {
+    unsigned char fg = console->sgr_fg;
+    unsigned char bg = console->sgr_bg;
+    if(console->sgr_flags & SGR_BOLD)
+        fg |= 0x8;
+    if(console->sgr_flags & SGR_REVERSE) {
+        unsigned char t = fg;
+        fg = bg;
+        bg = t;
+    }
+    console_set_attribute(console, (unsigned char)((bg << 4) | fg));
+}
+
+void console_ansi_reset(console_t console) {
+    console->ansi_state = ANSI_STATE_GROUND;
+    console->ansi_nparams = 0;
+    console->ansi_private = 0;
+    console->ansi_intermediate = 0;
+    console->scroll_top = 0;
+    console->scroll_bottom = console->height;
+    console->wrap_pending = false;
+    console->ansi_autowrap = true;
+    console->ansi_newline_mode = true;
+    console->ansi_default_attribute = console->attribute;
+    console->sgr_fg = console->attribute & 0xf;
+    console->sgr_bg = console->attribute >> 4;
+    console->sgr_flags = 0;
+    console->ansi_saved_x = 0;
+    console->ansi_saved_y = 0;
+    console->ansi_saved_attribute = console->attribute;
+    console->ansi_saved_sgr_fg = console->sgr_fg;
+    console->ansi_saved_sgr_bg = console->sgr_bg;
+    console->ansi_saved_sgr_flags = console->sgr_flags;
+}
+
+static unsigned console_ansi_param(console_t console, unsigned i, unsigned def) {
+    if(i >= console->ansi_nparams || console->ansi_params[i] == 0)
+        return def;
+    return console->ansi_params[i];
+}
+
+static void console_ansi_goto(console_t console, unsigned x, unsigned y) {
+    console->wrap_pending = false;
+    console_cursor_goto_xy(console, x, y);
+}
+
+static void console_ansi_fill(console_t console, unsigned x1, unsigned y, unsigned x2) {
+    if(x1 >= x2)
+        return;
+    struct cell * cell = console_row(console, y) + x1;
+    unsigned x;
+    for(x = x1; x < x2; ++x, ++cell) {
+        cell->cell.character = ' ';
+        cell->cell.attribute = console->attribute;
+    }
+    console_damage_rows(console, x1, y, x2, y + 1);
+}
+
+static void console_ansi_fill_rows(console_t console, unsigned y1, unsigned y2) {
+    for(; y1 < y2; ++y1)
+        console_ansi_fill(console, 0, y1, console->width);
+}
+
+/* scroll rows [top, bottom) up by n (n > 0) or down by -n */
+static void console_ansi_scroll(console_t console, unsigned top, unsigned bottom, int n) {
+    unsigned w = console->width;
+    if(top >= bottom || n == 0)
+        return;
+    unsigned k = (unsigned)abs(n);
+    if(k > bottom - top)
+        k = bottom - top;
+    unsigned y;
+    if(n > 0) {
+        for(y = top; y + k < bottom; ++y)
+            memcpy(console_row(console, y), console_row(console, y + k), w * sizeof(struct cell));
+        console_ansi_fill_rows(console, bottom - k, bottom);
+    } else {
+        for(y = bottom - 1; y >= top + k; --y)
+            memcpy(console_row(console, y), console_row(console, y - k), w * sizeof(struct cell));
+        console_ansi_fill_rows(console, top, top + k);
+    }
+    console_damage_rows(console, 0, top, w, bottom);
+}
+
+/*
+ * scroll the scroll region up by n, rows leaving the top of the whole
+ * screen go to the scrollback; deleting lines never feeds it
+ */
+static void console_ansi_scroll_up(console_t console, unsigned n) {
+    if(console->scroll_top == 0 && console->scroll_bottom == console->height) {
+        /* rotate the ring instead of moving rows */
+        console_scroll_lines(console, n);
+        return;
+    }
+    console_ansi_scroll(console, console->scroll_top, console->scroll_bottom, (int)n);
+}
+
+static void console_ansi_index(console_t console) {
+    unsigned y = console->cursor_y;
+    if(y + 1 == console->scroll_bottom)
+        console_ansi_scroll_up(console, 1);
+    else if(y + 1 < console->height)
+        ++y;
+    console_ansi_goto(console, console->cursor_x, y);
+}
+
+static void console_ansi_linefeed(console_t console) {
+    console_ansi_index(console);
+    if(console->ansi_newline_mode)
+        console_ansi_goto(console, 0, console->cursor_y);
+}
+
+static void console_ansi_reverse_index(console_t console) {
+    if(console->cursor_y == console->scroll_top)
+        console_ansi_scroll(console, console->scroll_top, console->scroll_bottom, -1);
+    else if(console->cursor_y > 0)
+        console_ansi_goto(console, console->cursor_x, console->cursor_y - 1);
+}
+
+/* writes a run of printable bytes, returns when the run is consumed */
+static void console_ansi_print(console_t console, const unsigned char * buf, size_t len) {
+    unsigned w = console->width;
+    while(len > 0) {
+        if(console->wrap_pending) {
+            console_ansi_index(console);
+            console_ansi_goto(console, 0, console->cursor_y);
+        }
+        unsigned x = console->cursor_x;
+        unsigned y = console->cursor_y;
+        unsigned n = min(len, w - x);
+        struct cell * cell = console_row(console, y) + x;
+        console_store_cells(cell, buf, n, console->attribute);
+        console_damage_rows(console, x, y, x + n, y + 1);
+        buf += n;
+        len -= n;
+        x += n;
+        if(x < w) {
+            console_cursor_goto_xy(console, x, y);
+        } else {
+            console_cursor_goto_xy(console, w - 1, y);
+            if(console->ansi_autowrap) {
+                console->wrap_pending = true;
+            } else if(len > 0) {
+                /* without autowrap the rest of the run overwrites the last column */
+                cell = console_row(console, y) + w - 1;
+                cell->cell.character = buf[len - 1];
+                cell->cell.attribute = console->attribute;
+                console_damage_rows(console, w - 1, y, w, y + 1);
+                len = 0;
+            }
+        }
+    }
+}
+
+static void console_ansi_execute(console_t console, unsigned char c) {
+    switch(c) {
+    case '\b':
+        if(console->cursor_x > 0)
+            console_ansi_goto(console, console->cursor_x - 1, console->cursor_y);
+        break;
+    case '\t': {
+        unsigned tab = console->tab_width ? console->tab_width : 8;
+        console_ansi_goto(console, (console->cursor_x / tab + 1) * tab, console->cursor_y);
+        break;
+    }
+    case '\n':
+    case '\v':
+    case '\f':
+        console_ansi_linefeed(console);
+        break;
+    case '\r':
+        console_ansi_goto(console, 0, console->cursor_y);
+        break;
+    default:
+        break;
+    }
+}
+
+static void console_ansi_save_cursor(console_t console) {
+    console->ansi_saved_x = console->cursor_x;
+    console->ansi_saved_y = console->cursor_y;
+    console->ansi_saved_attribute = console->attribute;
+    console->ansi_saved_sgr_fg = console->sgr_fg;
+    console->ansi_saved_sgr_bg = console->sgr_bg;
+    console->ansi_saved_sgr_flags = console->sgr_flags;
+}
+
+static void console_ansi_restore_cursor(console_t console) {
+    console->sgr_fg = console->ansi_saved_sgr_fg;
+    console->sgr_bg = console->ansi_saved_sgr_bg;
+    console->sgr_flags = console->ansi_saved_sgr_flags;
+    console_set_attribute(console, console->ansi_saved_attribute);
+    console_ansi_goto(console, console->ansi_saved_x, console->ansi_saved_y);
+}
+
+static void console_ansi_esc_dispatch(console_t console, unsigned char c) {
+    if(console->ansi_intermediate)
+        return; /* character set designations and the like */
+    switch(c) {
+    case '7':
+        console_ansi_save_cursor(console);
+        break;
+    case '8':
+        console_ansi_restore_cursor(console);
+        break;
+    case 'D':
+        console_ansi_index(console);
+        break;
+    case 'E':
+        console_ansi_index(console);
+        console_ansi_goto(console, 0, console->cursor_y);
+        break;
+    case 'M':
+        console_ansi_reverse_index(console);
+        break;
+    case 'c':
+        console_set_attribute(console, console->ansi_default_attribute);
+        console_ansi_reset(console);
+        console_clear(console);
+        console_set_attribute(console, console->ansi_default_attribute);
+        break;
+    default:
+        break;
+    }
+}
+
+static void console_ansi_sgr(console_t console) {
+    unsigned i;
+    if(console->ansi_nparams == 0)
+        console->ansi_params[console->ansi_nparams++] = 0;
+    for(i = 0; i < console->ansi_nparams; ++i) {
+        unsigned p = console->ansi_params[i];
+        if(p == 0) {
+            console->sgr_fg = console->ansi_default_attribute & 0xf;
+            console->sgr_bg = console->ansi_default_attribute >> 4;
+            console->sgr_flags = 0;
+        } else if(p == 1) {
+            console->sgr_flags |= SGR_BOLD;
+        } else if(p == 7) {
+            console->sgr_flags |= SGR_REVERSE;
+        } else if(p == 22) {
+            console->sgr_flags &= ~SGR_BOLD;
+        } else if(p == 27) {
+            console->sgr_flags &= ~SGR_REVERSE;
+        } else if(p >= 30 && p <= 37) {
+            console->sgr_fg = g_ansi_colors[p - 30];
+        } else if(p == 39) {
+            console->sgr_fg = console->ansi_default_attribute & 0xf;
+        } else if(p >= 40 && p <= 47) {
+            console->sgr_bg = g_ansi_colors[p - 40];
+        } else if(p == 49) {
+            console->sgr_bg = console->ansi_default_attribute >> 4;
+        } else if(p >= 90 && p <= 97) {
+            console->sgr_fg = g_ansi_colors[p - 90] | 0x8;
+        } else if(p >= 100 && p <= 107) {
+            console->sgr_bg = g_ansi_colors[p - 100] | 0x8;
+        } else if((p == 38 || p == 48) && i + 1 < console->ansi_nparams) {
+            /* extended colours have no 4-bit equivalent, skip their arguments */
+            i += console->ansi_params[i + 1] == 5 ? 2 : console->ansi_params[i + 1] == 2 ? 4 : 1;
+        }
+    }
+    console_ansi_apply_sgr(console);
+}
+
+static void console_ansi_set_mode(console_t console, bool set) {
+    unsigned i;
+    for(i = 0; i < console->ansi_nparams; ++i) {
+        unsigned p = console->ansi_params[i];
+        if(console->ansi_private == '?') {
+            if(p == 25) {
+                if(set)
+                    console_show_cursor(console);
+                else
+                    console_hide_cursor(console);
+            } else if(p == 7) {
+                console->ansi_autowrap = set;
+                if(!set)
+                    console->wrap_pending = false;
+            }
+        } else if(console->ansi_private == 0 && p == 20) {
+            console->ansi_newline_mode = set;
+        }
+    }
+}
+
+static void console_ansi_csi_dispatch(console_t console, unsigned char c) {
+    unsigned w = console->width;
+    unsigned h = console->height;
+    unsigned x = console->cursor_x;
+    unsigned y = console->cursor_y;
+    unsigned n = console_ansi_param(console, 0, 1);
+
+    if(console->ansi_intermediate)
+        return;
+    if(console->ansi_private && c != 'h' && c != 'l')
+        return;
+
+    switch(c) {
+    case 'A':
+        console_ansi_goto(console, x, y > n ? y - n : 0);
+        break;
+    case 'B':
+    case 'e':
+        console_ansi_goto(console, x, min(y + n, h - 1));
+        break;
+    case 'C':
+    case 'a':
+        console_ansi_goto(console, min(x + n, w - 1), y);
+        break;
+    case 'D':
+        console_ansi_goto(console, x > n ? x - n : 0, y);
+        break;
+    case 'E':
+        console_ansi_goto(console, 0, min(y + n, h - 1));
+        break;
+    case 'F':
+        console_ansi_goto(console, 0, y > n ? y - n : 0);
+        break;
+    case 'G':
+    case '`':
+        console_ansi_goto(console, n - 1, y);
+        break;
+    case 'H':
+    case 'f':
+        console_ansi_goto(console, console_ansi_param(console, 1, 1) - 1, n - 1);
+        break;
+    case 'd':
+        console_ansi_goto(console, x, n - 1);
+        break;
+    case 'J':
+        switch(console_ansi_param(console, 0, 0)) {
+        case 0:
+            console_ansi_fill(console, x, y, w);
+            console_ansi_fill_rows(console, y + 1, h);
+            break;
+        case 1:
+            console_ansi_fill_rows(console, 0, y);
+            console_ansi_fill(console, 0, y, x + 1);
+            break;
+        case 2:
+            console_ansi_fill_rows(console, 0, h);
+            break;
+        case 3:
+            console_clear_scrollback(console);
+            break;
+        }
+        break;
+    case 'K':
+        switch(console_ansi_param(console, 0, 0)) {
+        case 0:
+            console_ansi_fill(console, x, y, w);
+            break;
+        case 1:
+            console_ansi_fill(console, 0, y, x + 1);
+            break;
+        case 2:
+            console_ansi_fill(console, 0, y, w);
+            break;
+        }
+        break;
+    case '@':
+    case 'P': {
+        struct cell * row = console_row(console, y);
+        n = min(n, w - x);
+        if(c == '@')
+            memmove(row + x + n, row + x, (w - x - n) * sizeof(struct cell));
+        else
+            memmove(row + x, row + x + n, (w - x - n) * sizeof(struct cell));
+        console_damage_rows(console, x, y, w, y + 1);
+        if(c == '@')
+            console_ansi_fill(console, x, y, x + n);
+        else
+            console_ansi_fill(console, w - n, y, w);
+        break;
+    }
+    case 'X':
+        console_ansi_fill(console, x, y, min(x + n, w));
+        break;
+    case 'L':
+    case 'M':
+        if(y >= console->scroll_top && y < console->scroll_bottom) {
+            console_ansi_scroll(console, y, console->scroll_bottom, c == 'L' ? -(int)n : (int)n);
+            console_ansi_goto(console, 0, y);
+        }
+        break;
+    case 'S':
+        console_ansi_scroll_up(console, n);
+        break;
+    case 'T':
+        console_ansi_scroll(console, console->scroll_top, console->scroll_bottom, -(int)n);
+        break;
+    case 'm':
+        console_ansi_sgr(console);
+        break;
+    case 'r': {
+        unsigned top = console_ansi_param(console, 0, 1) - 1;
+        unsigned bottom = min(console_ansi_param(console, 1, h), h);
+        if(top + 1 < bottom) {
+            console->scroll_top = top;
+            console->scroll_bottom = bottom;
+            console_ansi_goto(console, 0, 0);
+        }
+        break;
+    }
+    case 's':
+        console_ansi_save_cursor(console);
+        break;
+    case 'u':
+        console_ansi_restore_cursor(console);
+        break;
+    case 'h':
+    case 'l':
+        console_ansi_set_mode(console, c == 'h');
+        break;
+    default:
+        break;
+    }
+}
+
+void console_ansi_write(console_t console, const unsigned char * buf, size_t len) {
+    const unsigned char * end = buf + len;
+    while(buf < end) {
+        unsigned char state = console->ansi_state;
+        if(state == ANSI_STATE_GROUND && *buf >= 0x20) {
+            /* everything from 0x20 up prints in the ground state */
+            size_t n = console_scan_printable(buf, end - buf);
+            console_ansi_print(console, buf, n);
+            buf += n;
+            continue;
+        }
+
+        unsigned char c = *buf++;
+        unsigned char t = g_ansi_table[state][c];
+        console->ansi_state = t & 0xf;
+        switch(t >> 4) {
+        case ANSI_ACTION_PRINT:
+            console_ansi_print(console, &c, 1);
+            break;
+        case ANSI_ACTION_EXECUTE:
+            console_ansi_execute(console, c);
+            break;
+        case ANSI_ACTION_CLEAR:
+            console->ansi_nparams = 0;
+            console->ansi_private = 0;
+            console->ansi_intermediate = 0;
+            break;
+        case ANSI_ACTION_COLLECT:
+            if(c >= 0x3c)
+                console->ansi_private = c;
+            else
+                console->ansi_intermediate = c;
+            break;
+        case ANSI_ACTION_PARAM:
+            if(console->ansi_nparams == 0)
+                console->ansi_params[console->ansi_nparams++] = 0;
+            if(c == ';') {
+                if(console->ansi_nparams < CONSOLE_ANSI_MAX_PARAMS)
+                    console->ansi_params[console->ansi_nparams++] = 0;
+            } else {
+                unsigned * p = &console->ansi_params[console->ansi_nparams - 1];
+                if(*p < 10000)
+                    *p = *p * 10 + (c - '0');
+            }
+            break;
+        case ANSI_ACTION_ESC_DISPATCH:
+            console_ansi_esc_dispatch(console, c);
+            break;
+        case ANSI_ACTION_CSI_DISPATCH:
+            console_ansi_csi_dispatch(console, c);
+            break;
+        default:
+            break;
+        }
+    }
+}
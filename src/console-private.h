@@ -0,0 +1,333 @@
+#ifndef CONSOLE_PRIVATE_H_
+#define CONSOLE_PRIVATE_H_
+
+#include "console.h"
+#include "pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+struct cell {
+    union {
+        struct {
+            unsigned char character;
+            unsigned char attribute;
+        } cell;
+        unsigned short cell_data;
+    };
+};
+
+struct span {
+    unsigned x1;
+    unsigned x2;
+};
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define CONSOLE_ANSI_MAX_PARAMS 16
+#define CONSOLE_FONT_DERIVED_SLOTS 8
+
+/* fonts created by console_font_load() and the importers */
+struct font_file {
+    font_t font;
+    void * map;             /* mapped file, or NULL if font_bitmap is malloc'd */
+    size_t map_size;
+    char name[CONSOLE_FONT_NAME_SIZE + 1];
+};
+
+/* registry slots for data derived from a font */
+enum {
+    CONSOLE_FONT_SLOT_GLYPH_INFO,
+    CONSOLE_FONT_SLOT_GLYPH_PACK,
+    CONSOLE_FONT_SLOT_ROTATE_90,
+    CONSOLE_FONT_SLOT_ROTATE_180,
+    CONSOLE_FONT_SLOT_ROTATE_270,
+    CONSOLE_FONT_SLOT_ROTATE_90_PACKED,
+    CONSOLE_FONT_SLOT_ROTATE_180_PACKED,
+    CONSOLE_FONT_SLOT_ROTATE_270_PACKED
+};
+
+/* largest byte padded glyph the packed storage will unpack */
+#define CONSOLE_GLYPH_MAX_BYTES 512
+
+#define GLYPH_BLANK         0x01    /* no pixel set */
+#define GLYPH_SOLID         0x02    /* every pixel set */
+#define GLYPH_DESCENDER     0x04    /* ink below the baseline */
+
+/* empty margins are counted in pixels from each edge of the cell */
+struct glyph_info {
+    unsigned char flags;
+    unsigned char left;
+    unsigned char right;
+    unsigned char top;
+    unsigned char bottom;
+};
+
+struct console {
+    unsigned height;
+    unsigned width;
+
+    unsigned view_height;
+    unsigned view_width;
+
+    /* glyph size, cells are font_scale times larger */
+    unsigned char_height;
+    unsigned char_width;
+    unsigned font_scale;
+
+    unsigned cursor_x;
+    unsigned cursor_y;
+    unsigned saved_cursor_x;
+    unsigned saved_cursor_y;
+    unsigned char attribute;
+
+    struct cell * buffer;
+    unsigned head;
+
+    console_mode mode;
+    unsigned tab_width;
+    unsigned char cursor_state;
+    unsigned cursor_blink_rate;
+    console_rgb_t palette[16];
+    uint32_t native_palette[CONSOLE_PIXEL_FORMAT_COUNT][CONSOLE_NUM_PALETTE_ENTRIES];
+    unsigned char yuv_palette[CONSOLE_NUM_PALETTE_ENTRIES][3];
+    console_gray_mode gray_mode;
+    unsigned char gray_threshold;
+    uint16_t gray_pattern[3][CONSOLE_NUM_PALETTE_ENTRIES][4];   /* 1, 2, 4 bpp by row phase */
+    font_id_t font_id;
+    const font_t * font;
+    const struct glyph_info * glyph_info;
+    bool packed_glyphs;
+    const struct glyph_pack * glyph_pack;
+    console_rotation rotation;
+    const struct glyph_rotated * glyph_rotated;
+    console_callback_t callback;
+    void * callback_data;
+
+    bool deferred;
+    struct span * dirty;
+    unsigned pending_scroll;
+    unsigned flushed_cursor_x;
+    unsigned flushed_cursor_y;
+    bool flushed_cursor_shown;
+
+    struct tile_cache * tile_cache;
+    size_t tile_cache_size;         /* bytes per cache */
+    struct tile_cache ** band_caches;
+    unsigned band_cache_count;
+    struct byte_queue * queue;
+    struct snapshot_state * snapshots;
+    uint64_t * row_generation;      /* per physical row, snapshot it was last changed for */
+    uint64_t snapshot_generation;
+    _Atomic(console_group_t) group;
+    _Atomic unsigned group_state;   /* scheduled, dirty and removed bits, see group.c */
+    struct pool_batch group_batch;  /* the console's task, for removal to wait on */
+    console_group_render_t group_render;
+    void * group_render_data;
+    struct cell * shadow;           /* view at the last console_diff */
+    unsigned shadow_cursor_x;
+    unsigned shadow_cursor_y;
+    unsigned shadow_view_offset;    /* the cursor was drawn this many rows down */
+    bool shadow_cursor_shown;
+    uint32_t * yuv_acc;             /* chroma sums of the last unaligned YUV render */
+    size_t yuv_acc_size;
+
+    struct cell * scrollback;
+    unsigned scrollback_limit_rows;
+    size_t scrollback_limit_bytes;
+    unsigned scrollback_capacity;
+    unsigned scrollback_count;
+    unsigned scrollback_head;
+    unsigned view_offset;
+
+    unsigned char ansi_state;
+    unsigned char ansi_private;
+    unsigned char ansi_intermediate;
+    unsigned ansi_nparams;
+    unsigned ansi_params[CONSOLE_ANSI_MAX_PARAMS];
+    unsigned scroll_top;
+    unsigned scroll_bottom;
+    bool wrap_pending;
+    bool ansi_autowrap;
+    bool ansi_newline_mode;
+    unsigned char ansi_default_attribute;
+    unsigned char sgr_fg;
+    unsigned char sgr_bg;
+    unsigned char sgr_flags;
+    unsigned ansi_saved_x;
+    unsigned ansi_saved_y;
+    unsigned char ansi_saved_attribute;
+    unsigned char ansi_saved_sgr_fg;
+    unsigned char ansi_saved_sgr_bg;
+    unsigned char ansi_saved_sgr_flags;
+};
+
+#define CURSOR_VISIBLE 1
+#define CURSOR_SHOWN 2
+
+/* rows are stored as a ring starting at physical row head */
+static inline struct cell * console_row(console_t console, unsigned y) {
+    unsigned r = console->head + y;
+    if(r >= console->height)
+        r -= console->height;
+    return console->buffer + (size_t)r * console->width;
+}
+
+/* back counts rows from the newest history row, which is 1 */
+static inline struct cell * console_scrollback_row(console_t console, unsigned back) {
+    unsigned r = console->scrollback_head + console->scrollback_count - back;
+    if(r >= console->scrollback_capacity)
+        r -= console->scrollback_capacity;
+    return console->scrollback + (size_t)r * console->width;
+}
+
+/* row y of the viewport, which starts view_offset rows back in history */
+static inline const struct cell * console_view_row(console_t console, unsigned y) {
+    if(y < console->view_offset)
+        return console_scrollback_row(console, console->view_offset - y);
+    return console_row(console, y - console->view_offset);
+}
+
+/* glyph and cell sizes in framebuffer orientation swap for 90 and 270 degrees */
+static inline bool console_rotated_sideways(console_t console) {
+    return console->rotation == CONSOLE_ROTATE_90 || console->rotation == CONSOLE_ROTATE_270;
+}
+
+/* framebuffer pixel at the top left corner of cell (x, y) */
+static inline void console_cell_origin(console_t console, unsigned x, unsigned y, unsigned * px, unsigned * py) {
+    unsigned cw = console->char_width * console->font_scale;
+    unsigned ch = console->char_height * console->font_scale;
+    switch(console->rotation) {
+    case CONSOLE_ROTATE_90:
+        *px = console->view_height - (y + 1) * ch;
+        *py = x * cw;
+        break;
+    case CONSOLE_ROTATE_180:
+        *px = console->view_width - (x + 1) * cw;
+        *py = console->view_height - (y + 1) * ch;
+        break;
+    case CONSOLE_ROTATE_270:
+        *px = y * ch;
+        *py = console->view_width - (x + 1) * cw;
+        break;
+    case CONSOLE_ROTATE_0:
+    default:
+        *px = x * cw;
+        *py = y * ch;
+        break;
+    }
+}
+
+/* glyphs past the end of the font fall back to glyph 0 */
+static inline const unsigned char * console_glyph(console_t console, unsigned char c) {
+    const font_t * font = console->font;
+    unsigned bytes_per_char = (console->char_width + 7) / 8 * console->char_height;
+    if(c >= font->glyph_count)
+        c = 0;
+    return font->font_bitmap + (size_t)c * bytes_per_char;
+}
+
+void console_damage_rows(console_t console, unsigned x1, unsigned y1, unsigned x2, unsigned y2);
+
+void console_ansi_reset(console_t console);
+void console_ansi_write(console_t console, const unsigned char * buf, size_t len);
+
+void console_scrollback_free(console_t console);
+void console_scrollback_reset(console_t console);
+void console_scrollback_push(console_t console, unsigned n);
+
+/* per-font data shared by every console using the font, created on first use */
+void * console_font_derived(const font_t * font, unsigned slot,
+        void * (*create)(const font_t * font), void (*destroy)(void * data));
+
+const struct glyph_info * console_glyph_info(const font_t * font);
+
+/*
+ * packed glyph rows are concatenated at bit granularity, glyphs of width
+ * multiple of 8 or over 56 pixels are never packed
+ */
+bool console_glyph_pack_fits(unsigned width, unsigned height);
+size_t console_glyph_packed_bytes(unsigned width, unsigned height);
+void console_glyph_pack(unsigned char * dst, const unsigned char * src, unsigned width, unsigned height);
+/* reads up to 8 bytes past the end of src */
+void console_glyph_unpack(unsigned char * dst, const unsigned char * src, unsigned width, unsigned height);
+
+void console_glyph_pack_update(console_t console);
+void console_glyph_rotate_update(console_t console);
+/* unpacked into scratch if the rotated glyphs are stored packed */
+const unsigned char * console_glyph_rotated(console_t console, unsigned char c, unsigned char * scratch);
+/*
+ * byte padded rows of glyph c as drawn into the framebuffer: rotated if
+ * the console is, unpacked into scratch if glyphs are stored packed
+ */
+const unsigned char * console_glyph_bits(console_t console, unsigned char c, unsigned char * scratch);
+
+/* tile cache format of the luma plane of the YUV targets */
+#define CONSOLE_PIXEL_Y8 ((console_pixel_format)CONSOLE_PIXEL_FORMAT_COUNT)
+
+static inline unsigned console_pixel_bits(console_pixel_format format) {
+    switch(format) {
+    case CONSOLE_PIXEL_RGB565:
+        return 16;
+    case CONSOLE_PIXEL_INDEX8:
+    case CONSOLE_PIXEL_Y8:
+        return 8;
+    case CONSOLE_PIXEL_MONO1:
+        return 1;
+    case CONSOLE_PIXEL_GRAY2:
+        return 2;
+    case CONSOLE_PIXEL_GRAY4:
+        return 4;
+    default:
+        return 32;
+    }
+}
+
+static inline unsigned console_pixel_bytes(console_pixel_format format) {
+    return console_pixel_bits(format) / 8;
+}
+
+/* converts the palette into every pixel format */
+void console_palette_convert(console_t console);
+void console_gray_convert(console_t console);
+void console_yuv_convert(console_t console);
+void console_render_gray(console_t console, void * pixels, size_t stride, console_pixel_format format,
+        unsigned x1, unsigned y1, unsigned x2, unsigned y2);
+/* console_render_rect looking tiles up in cache, which only one thread may use at a time */
+void console_render_rect_cached(console_t console, struct tile_cache ** cache, void * pixels, size_t stride,
+        console_pixel_format format, unsigned x1, unsigned y1, unsigned x2, unsigned y2);
+
+/* draws a glyph at the console's font scale, stride is in bytes, fg and bg are native pixels */
+void console_expand_glyph(console_t console, void * pixels, size_t stride, unsigned bytes_per_pixel,
+        const unsigned char * glyph, uint32_t fg, uint32_t bg);
+
+void console_queue_free(console_t console);
+
+void console_diff_free(console_t console);
+
+void console_snapshot_free(console_t console);
+void console_snapshot_resize(console_t console);
+void console_snapshot_touch_rows(console_t console, unsigned y1, unsigned y2);
+
+/* live rows [y1, y2) changed, the next snapshot copies them */
+static inline void console_snapshot_touch(console_t console, unsigned y1, unsigned y2) {
+    if(console->row_generation)
+        console_snapshot_touch_rows(console, y1, min(y2, console->height));
+}
+
+void console_tile_cache_free(console_t console);
+void console_tile_cache_invalidate(console_t console);
+/* band caches are created on first use, one per thread of a band render past the first */
+bool console_band_caches_reserve(console_t console, unsigned count);
+const void * console_tile_cache_lookup(console_t console, struct tile_cache ** cache, unsigned char c,
+        unsigned char attr, console_pixel_format format, uint32_t fg, uint32_t bg);
+
+struct pool * console_group_pool(console_group_t group);
+
+#endif /* CONSOLE_PRIVATE_H_ */
@@ -1,5 +1,7 @@
 #include "console.h"
+#include "console-private.h"
 #include "font.h"
+#include "simd.h"
 #include <malloc.h>
 #include <string.h>
 #include <stdlib.h>
@@ -7,47 +9,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-struct cell {
-    union {
-        struct {
-            unsigned char character;
-            unsigned char attribute;
-        } cell;
-        unsigned short cell_data;
-    };
-};
-
-struct console {
-    unsigned height;
-    unsigned width;
-
-    unsigned view_height;
-    unsigned view_width;
-
-    unsigned char_height;
-    unsigned char_width;
-
-    unsigned cursor_x;
-    unsigned cursor_y;
-    unsigned saved_cursor_x;
-    unsigned saved_cursor_y;
-    unsigned char attribute;
-
-    struct cell * buffer;
-
-    console_mode mode;
-    unsigned tab_width;
-    unsigned char cursor_state;
-    unsigned cursor_blink_rate;
-    console_rgb_t palette[16];
-    font_id_t font_id;
-    console_callback_t callback;
-    void * callback_data;
-};
-
-#define CURSOR_VISIBLE 1
-#define CURSOR_SHOWN 2
-
 /* http://en.wikipedia.org/wiki/ANSI_escape_code*/
 static console_rgb_t g_palette[] = {
     /* normal */
@@ -73,6 +34,8 @@ static console_rgb_t g_palette[] = {
 static void console_callback(console_t console, console_update_t * p, void * data) {
 }
 
+static void console_damage_reset(console_t console);
+
 console_t console_alloc(unsigned width, unsigned height, font_id_t font) {
     console_t console = (console_t)calloc(1, sizeof(struct console));
     console->view_width = width;
@@ -80,6 +43,9 @@ console_t console_alloc(unsigned width, unsigned height, font_id_t font) {
     console_set_mode(console, CONSOLE_MODE_RAW);
     console_set_tab_width(console, 4);
     console_set_callback(console, NULL, NULL);
+    console_set_tile_cache_size(console, CONSOLE_TILE_CACHE_DEFAULT_SIZE);
+    console->font_scale = 1;
+    console->gray_threshold = 128;
     console_set_palette(console, &g_palette[0]);
     console_set_font(console, font);
     console_set_cursor_blink_rate(console, 200);
@@ -90,13 +56,47 @@ console_t console_alloc(unsigned width, unsigned height, font_id_t font) {
 
 void console_free(console_t console) {
     if(console) {
+        console_group_t group = atomic_load_explicit(&console->group, memory_order_relaxed);
+        if(group)
+            console_group_remove(group, console);
         console->callback_data = NULL;
+        console_tile_cache_free(console);
+        free(console->band_caches);
+        console_scrollback_free(console);
+        console_queue_free(console);
+        console_snapshot_free(console);
+        console_diff_free(console);
+        console_font_release(console->font);
+        free(console->yuv_acc);
+        free(console->dirty);
         free(console->buffer);
         free(console);
     }
 }
 
+static void console_reverse_cells(struct cell * first, struct cell * last) {
+    for(; first < last; ++first, --last) {
+        struct cell t = *first;
+        *first = *last;
+        *last = t;
+    }
+}
+
+void console_linearize(console_t console) {
+    if(console->head == 0)
+        return;
+    /* rotate the ring in place so that row 0 is stored first */
+    size_t n = (size_t)console->width * console->height;
+    size_t k = (size_t)console->head * console->width;
+    console_reverse_cells(console->buffer, console->buffer + k - 1);
+    console_reverse_cells(console->buffer + k, console->buffer + n - 1);
+    console_reverse_cells(console->buffer, console->buffer + n - 1);
+    console->head = 0;
+    console_snapshot_touch(console, 0, console->height);
+}
+
 unsigned short * console_get_raw_buffer(console_t console) {
+    console_linearize(console);
     return (unsigned short*)console->buffer;
 }
 
@@ -134,28 +134,29 @@ unsigned console_get_cursor_blink_rate(console_t console) {
     return console->cursor_blink_rate;
 }
 
-void console_show_cursor(console_t console) {
-    if(console->cursor_state & CURSOR_VISIBLE)
+static void console_update_cursor_visibility(console_t console, bool visible) {
+    if(console->deferred)
         return;
-    console->cursor_state |= CURSOR_VISIBLE;
     console_update_t u;
     u.type = CONSOLE_UPDATE_CURSOR_VISIBILITY;
-    u.data.u_cursor.cursor_visible = true;
+    u.data.u_cursor.cursor_visible = visible;
     u.data.u_cursor.x = console->cursor_x;
     u.data.u_cursor.y = console->cursor_y;
     console->callback(console, &u, console->callback_data);
 }
 
+void console_show_cursor(console_t console) {
+    if(console->cursor_state & CURSOR_VISIBLE)
+        return;
+    console->cursor_state |= CURSOR_VISIBLE;
+    console_update_cursor_visibility(console, true);
+}
+
 void console_hide_cursor(console_t console) {
     if(!(console->cursor_state & CURSOR_VISIBLE))
         return;
     console->cursor_state &= ~(CURSOR_VISIBLE | CURSOR_SHOWN);
-    console_update_t u;
-    u.type = CONSOLE_UPDATE_CURSOR_VISIBILITY;
-    u.data.u_cursor.cursor_visible = false;
-    u.data.u_cursor.x = console->cursor_x;
-    u.data.u_cursor.y = console->cursor_y;
-    console->callback(console, &u, console->callback_data);
+    console_update_cursor_visibility(console, false);
 }
 
 void console_blink_cursor(console_t console) {
@@ -168,12 +169,7 @@ void console_blink_cursor(console_t console) {
     bool was_shown = (((console->cursor_state & CURSOR_SHOWN) >> 1) ? true : false);
     if(shown != was_shown) {
         console->cursor_state ^= CURSOR_SHOWN;
-        console_update_t u;
-        u.type = CONSOLE_UPDATE_CURSOR_VISIBILITY;
-        u.data.u_cursor.cursor_visible = console_cursor_is_shown(console);
-        u.data.u_cursor.x = console->cursor_x;
-        u.data.u_cursor.y = console->cursor_y;
-        console->callback(console, &u, console->callback_data);
+        console_update_cursor_visibility(console, console_cursor_is_shown(console));
     }
 }
 
@@ -182,46 +178,221 @@ void console_set_callback(console_t console, console_callback_t callback, void *
     console->callback_data = data;
 }
 
+static void console_update_rows(console_t console, unsigned x1, unsigned y1, unsigned x2, unsigned y2);
+
+/*
+ * Damages the cells of the view drawn in one of the changed colours. The
+ * rows are scanned on every palette change rather than tracked on every
+ * cell write, which also covers cells written through the raw buffer.
+ */
+static void console_damage_palette(console_t console, unsigned changed) {
+    const struct glyph_info * info = console->glyph_info;
+    bool uses[256];
+    unsigned a, x, y;
+    if(!console->buffer)
+        return;
+    for(a = 0; a < 256; ++a)
+        uses[a] = (changed >> (a & 0xf) | changed >> (a >> 4)) & 1;
+
+    /* runs of affected rows become one update, like console_flush */
+    unsigned w = console->width;
+    unsigned run_y = 0, run_x1 = w, run_x2 = 0;
+    unsigned cursor_x = w, cursor_y = console->cursor_y + console->view_offset;
+    if(console_cursor_is_shown(console))
+        cursor_x = console->cursor_x;
+    for(y = 0; y < console->height; ++y) {
+        const struct cell * cell = console_view_row(console, y);
+        unsigned x1 = w, x2 = 0;
+        for(x = 0; x < w; ++x, ++cell) {
+            unsigned char c = cell->cell.character;
+            unsigned char attr = cell->cell.attribute;
+            bool hit;
+            /*
+             * blank glyphs only show the background, solid ones the
+             * foreground, except under the cursor which swaps the two
+             */
+            if(x == cursor_x && y == cursor_y)
+                hit = uses[attr];
+            else if(info && (info[c].flags & GLYPH_BLANK))
+                hit = (changed >> (attr >> 4)) & 1;
+            else if(info && (info[c].flags & GLYPH_SOLID))
+                hit = (changed >> (attr & 0xf)) & 1;
+            else
+                hit = uses[attr];
+            if(hit) {
+                x1 = min(x1, x);
+                x2 = x + 1;
+            }
+        }
+        if(x1 < x2) {
+            if(run_x1 >= run_x2)
+                run_y = y;
+            run_x1 = min(run_x1, x1);
+            run_x2 = max(run_x2, x2);
+        } else if(run_x1 < run_x2) {
+            console_update_rows(console, run_x1, run_y, run_x2, y);
+            run_x1 = w;
+            run_x2 = 0;
+        }
+    }
+    if(run_x1 < run_x2)
+        console_update_rows(console, run_x1, run_y, run_x2, console->height);
+}
+
 void console_set_palette(console_t console, console_rgb_t const * palette) {
-    memcpy(console->palette, palette, sizeof(console_rgb_t) * 16);
+    unsigned changed = 0, i;
+    for(i = 0; i < CONSOLE_NUM_PALETTE_ENTRIES; ++i) {
+        if(memcmp(&console->palette[i], &palette[i], sizeof(console_rgb_t)))
+            changed |= 1u << i;
+    }
+    if(changed) {
+        memcpy(console->palette, palette, sizeof(console_rgb_t) * 16);
+        console_palette_convert(console);
+        console_tile_cache_invalidate(console);
+    }
+    /* sent even when nothing changed, clients may use it to reload the palette */
     console_update_t u;
     u.type = CONSOLE_UPDATE_PALETTE;
     u.data.u_palette.palette = console->palette;
+    u.data.u_palette.changed = (unsigned short)changed;
     console->callback(console, &u, console->callback_data);
+    if(changed)
+        console_damage_palette(console, changed);
 }
 
 void console_get_palette(console_t console, console_rgb_t * palette) {
     memcpy(palette, console->palette, sizeof(console_rgb_t) * 16);
 }
 
-void console_set_font(console_t console, font_id_t font) {
-    if(console->font_id == font)
-        return;
+static void console_apply_font(console_t console, const font_t * font) {
+    console_font_acquire(font);
+    console_font_release(console->font);
+    console->font = font;
+    console->glyph_info = console_glyph_info(font);
+    console_glyph_pack_update(console);
+    console_glyph_rotate_update(console);
+    console_tile_cache_invalidate(console);
 
-    console->font_id = font;
-
-    console->char_height = console_fonts[font].char_height;
-    console->char_width = console_fonts[font].char_width;
+    console->char_height = font->char_height;
+    console->char_width = font->char_width;
 
-    console->width = console->view_width / console->char_width;
-    console->height = console->view_height / console->char_height;
+    console->width = console->view_width / (console->char_width * console->font_scale);
+    console->height = console->view_height / (console->char_height * console->font_scale);
 
     size_t num_cells = console->width * console->height;
     console->buffer = realloc(console->buffer, num_cells * sizeof(struct cell));
+    console->head = 0;
+    console->scroll_top = 0;
+    console->scroll_bottom = console->height;
+    console->wrap_pending = false;
+    console_scrollback_reset(console);
+    console_snapshot_resize(console);
+    console_diff_free(console);
+    if(console->deferred)
+        console_damage_reset(console);
 
     console_update_t u;
     u.type = CONSOLE_UPDATE_FONT;
     u.data.u_font.char_width = console->char_width;
     u.data.u_font.char_height = console->char_height;
-    u.data.u_font.font_bitmap = console_fonts[font].font_bitmap;
+    u.data.u_font.font_bitmap = font->font_bitmap;
+    u.data.u_font.scale = console->font_scale;
     console->callback(console, &u, console->callback_data);
 }
 
+void console_set_font(console_t console, font_id_t font) {
+    if(console->font_id == font && console->buffer)
+        return;
+
+    console->font_id = font;
+    console_apply_font(console, &console_fonts[font]);
+}
+
+/* font must stay valid until the console switches to another one */
+void console_set_font_data(console_t console, const font_t * font) {
+    if(console->font == font && console->buffer)
+        return;
+
+    console->font_id = CONSOLE_NUM_FONTS;
+    console_apply_font(console, font);
+}
+
+const font_t * console_get_font_data(console_t console) {
+    return console->font;
+}
+
+/* glyphs are drawn scale times larger, the grid is laid out again to fit the view */
+void console_set_font_scale(console_t console, unsigned scale) {
+    if(scale < 1)
+        scale = 1;
+    if(scale > CONSOLE_MAX_FONT_SCALE)
+        scale = CONSOLE_MAX_FONT_SCALE;
+    if(console->font_scale == scale)
+        return;
+
+    console->font_scale = scale;
+    console_apply_font(console, console->font);
+}
+
+unsigned console_get_font_scale(console_t console) {
+    return console->font_scale;
+}
+
 font_id_t console_get_font(console_t console) {
     return console->font_id;
 }
 
+static void console_damage(console_t console, unsigned x1, unsigned y, unsigned x2) {
+    struct span * span = &console->dirty[y];
+    if(span->x1 >= span->x2) {
+        span->x1 = x1;
+        span->x2 = x2;
+        return;
+    }
+    if(x1 < span->x1)
+        span->x1 = x1;
+    if(x2 > span->x2)
+        span->x2 = x2;
+}
+
+static void console_damage_scroll(console_t console, unsigned n) {
+    unsigned h = console->height;
+    n = min(n, h);
+    if(n < h)
+        memmove(console->dirty, console->dirty + n, (h - n) * sizeof(struct span));
+    unsigned y;
+    for(y = h - n; y < h; ++y) {
+        console->dirty[y].x1 = 0;
+        console->dirty[y].x2 = console->width;
+    }
+    console->pending_scroll = min(console->pending_scroll + n, h);
+}
+
+static void console_view_follow(console_t console);
+
+static void console_update_char(console_t console, unsigned x, unsigned y, unsigned char c, unsigned char a) {
+    console_view_follow(console);
+    console_snapshot_touch(console, y, y + 1);
+    if(console->deferred) {
+        console_damage(console, x, y, x + 1);
+        return;
+    }
+    console_update_t u;
+    u.type = CONSOLE_UPDATE_CHAR;
+    u.data.u_char.x = x;
+    u.data.u_char.y = y;
+    u.data.u_char.c = c;
+    u.data.u_char.a = a;
+    console->callback(console, &u, console->callback_data);
+}
+
 static void console_update_rows(console_t console, unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    console_snapshot_touch(console, y1, y2);
+    if(console->deferred) {
+        for(; y1 < y2; ++y1)
+            console_damage(console, x1, y1, x2);
+        return;
+    }
     console_update_t u;
     u.type = CONSOLE_UPDATE_ROWS;
     u.data.u_rows.x1 = x1;
@@ -231,6 +402,59 @@ static void console_update_rows(console_t console, unsigned x1, unsigned y1, uns
     console->callback(console, &u, console->callback_data);
 }
 
+static void console_scroll_buffer(console_t console, unsigned n) {
+    unsigned w = console->width;
+    unsigned h = console->height;
+
+    console_scrollback_push(console, min(n, h));
+
+    /* rows are a ring, so scrolling only rotates the head and blanks the new rows */
+    if(n < h) {
+        console->head += n;
+        if(console->head >= h)
+            console->head -= h;
+    } else {
+        n = h;
+        console->head = 0;
+    }
+    console_snapshot_touch(console, h - n, h);
+    unsigned y;
+    for(y = h - n; y < h; ++y) {
+        struct cell * cell = console_row(console, y);
+        unsigned x;
+        for(x = 0; x < w; ++x, ++cell) {
+            cell->cell.character = 0;
+            cell->cell.attribute = console->attribute;
+        }
+    }
+}
+
+/* the SCROLL event, or its damage when deferred */
+static void console_update_scroll(console_t console, unsigned n) {
+    if(console->deferred) {
+        console_damage_scroll(console, n);
+        return;
+    }
+
+    unsigned h = console->height;
+    console_update_t u;
+    u.type = CONSOLE_UPDATE_SCROLL;
+    u.data.u_scroll.y1 = 0;
+    u.data.u_scroll.y2 = min(h, n);
+    u.data.u_scroll.n = h - min(h, n);
+    console->callback(console, &u, console->callback_data);
+}
+
+static void console_update_scroll_begin(console_t console, unsigned n) {
+    console_view_follow(console);
+    console_update_cursor_visibility(console, false);
+    console_update_scroll(console, n);
+}
+
+static void console_update_scroll_end(console_t console) {
+    console_update_cursor_visibility(console, console_cursor_is_shown(console));
+}
+
 void console_clear(console_t console) {
     console_cursor_goto_xy(console, 0, 0);
     console->attribute = 0xf;
@@ -238,6 +462,8 @@ void console_clear(console_t console) {
     struct cell * buffer = console->buffer;
     for(;x > 0; --x, ++buffer)
         buffer->cell_data = 0x7;
+    console->head = 0;
+    console_view_follow(console);
     console_update_rows(console, 0, 0, console->width, console->height);
 }
 
@@ -255,6 +481,10 @@ static void console_cursor_advance(console_t console) {
 }
 
 void console_print_char(console_t console, unsigned char c) {
+    if(console->mode == CONSOLE_MODE_ANSI) {
+        console_ansi_write(console, &c, 1);
+        return;
+    }
     if(c == '\n') {
         unsigned x = 0;
         unsigned y = console->cursor_y;
@@ -274,26 +504,109 @@ void console_print_char(console_t console, unsigned char c) {
     }
 
     if(console->mode == CONSOLE_MODE_RAW) {
-        size_t offset = console->cursor_y * console->width + console->cursor_x;
-        unsigned char old_c = console->buffer[offset].cell.character;
-        unsigned char old_a = console->buffer[offset].cell.attribute;
-        console->buffer[offset].cell.character = c;
-        console->buffer[offset].cell.attribute = console->attribute;
-
-        if(old_c != c || old_a != console->attribute) {
-            console_update_t u;
-            u.type = CONSOLE_UPDATE_CHAR;
-            u.data.u_char.x = console->cursor_x;
-            u.data.u_char.y = console->cursor_y;
-            u.data.u_char.c = c;
-            u.data.u_char.a = console->attribute;
-            console->callback(console, &u, console->callback_data);
-        }
+        struct cell * cell = console_row(console, console->cursor_y) + console->cursor_x;
+        unsigned char old_c = cell->cell.character;
+        unsigned char old_a = cell->cell.attribute;
+        cell->cell.character = c;
+        cell->cell.attribute = console->attribute;
+
+        if(old_c != c || old_a != console->attribute)
+            console_update_char(console, console->cursor_x, console->cursor_y, c, console->attribute);
 
         console_cursor_advance(console);
     }
 }
 
+void console_write(console_t console, const unsigned char * buf, size_t len) {
+    if(console->mode == CONSOLE_MODE_ANSI) {
+        console_ansi_write(console, buf, len);
+        return;
+    }
+
+    unsigned w = console->width;
+    unsigned h = console->height;
+    unsigned x = console->cursor_x;
+    unsigned y = console->cursor_y;
+    unsigned scrolled = 0;
+    unsigned tab = 0;
+    /* damaged rectangle in post-scroll coordinates, empty while x1 >= x2 */
+    unsigned x1 = w, y1 = h, x2 = 0, y2 = 0;
+
+    while(len > 0 || tab > 0) {
+        unsigned n = 0;
+        struct cell * cell = console_row(console, y) + x;
+        if(tab > 0) {
+            n = min(tab, w - x);
+            unsigned i;
+            for(i = 0; i < n; ++i, ++cell) {
+                cell->cell.character = ' ';
+                cell->cell.attribute = console->attribute;
+            }
+            tab -= n;
+        } else if(*buf == '\n') {
+            ++buf;
+            --len;
+            x = 0;
+            ++y;
+        } else if(*buf == '\t') {
+            ++buf;
+            --len;
+            tab = console->tab_width;
+            continue;
+        } else {
+            /* run of printable bytes up to the end of the row */
+            n = console_scan_text(buf, min(len, w - x));
+            console_store_cells(cell, buf, n, console->attribute);
+            buf += n;
+            len -= n;
+        }
+        if(n > 0) {
+            x1 = min(x1, x);
+            x2 = max(x2, x + n);
+            y1 = min(y1, y);
+            y2 = max(y2, y + 1);
+            x += n;
+            if(x >= w) {
+                x = 0;
+                ++y;
+            }
+        }
+        if(y < h)
+            continue;
+
+        /* fell off the bottom row, hide the cursor while its cell still holds what it showed */
+        if(scrolled == 0) {
+            console_view_follow(console);
+            console_update_cursor_visibility(console, false);
+        }
+        y = h - 1;
+        console_scroll_buffer(console, 1);
+        ++scrolled;
+        if(y1 > 0)
+            --y1;
+        x1 = 0;
+        x2 = w;
+        y1 = min(y1, h - 1);
+        y2 = h;
+    }
+
+    /* move the cursor first, so the repainted rows draw it where scroll_end shows it */
+    if(scrolled > 0) {
+        console_update_scroll(console, scrolled);
+        console->cursor_x = x;
+        console->cursor_y = y;
+    }
+    if(x1 < x2) {
+        console_view_follow(console);
+        console_update_rows(console, x1, y1, x2, y2);
+    }
+    if(scrolled > 0) {
+        console_update_scroll_end(console);
+    } else {
+        console_cursor_goto_xy(console, x, y);
+    }
+}
+
 void console_set_attribute(console_t console, unsigned char attr) {
     console->attribute = attr;
 }
@@ -301,40 +614,20 @@ void console_set_attribute(console_t console, unsigned char attr) {
 void console_set_character_and_attribute_at(console_t console, unsigned x, unsigned y, unsigned char c, unsigned char attr) {
     if(x >= console->width || y >= console->height)
         return;
-    size_t offset = y * console->width + x;
-    unsigned char old_c = console->buffer[offset].cell.character;
-    unsigned char old_a = console->buffer[offset].cell.attribute;
-    console->buffer[offset].cell.character = c;
-    console->buffer[offset].cell.attribute = attr;
+    struct cell * cell = console_row(console, y) + x;
+    unsigned char old_c = cell->cell.character;
+    unsigned char old_a = cell->cell.attribute;
+    cell->cell.character = c;
+    cell->cell.attribute = attr;
 
-    if(old_c != c || old_a != attr) {
-        console_update_t u;
-        u.type = CONSOLE_UPDATE_CHAR;
-        u.data.u_char.x = x;
-        u.data.u_char.y = y;
-        u.data.u_char.c = c;
-        u.data.u_char.a = attr;
-        console->callback(console, &u, console->callback_data);
-    }
+    if(old_c != c || old_a != attr)
+        console_update_char(console, x, y, c, attr);
 }
 
 void console_set_character_and_attribute_at_offset(console_t console, unsigned offset, unsigned char c, unsigned char attr) {
     if(offset >= console->width * console->height)
         return;
-    unsigned char old_c = console->buffer[offset].cell.character;
-    unsigned char old_a = console->buffer[offset].cell.attribute;
-    console->buffer[offset].cell.character = c;
-    console->buffer[offset].cell.attribute = attr;
-
-    if(old_c != c || old_a != attr) {
-        console_update_t u;
-        u.type = CONSOLE_UPDATE_CHAR;
-        u.data.u_char.x = offset % console->width;
-        u.data.u_char.y = offset / console->width;
-        u.data.u_char.c = c;
-        u.data.u_char.a = attr;
-        console->callback(console, &u, console->callback_data);
-    }
+    console_set_character_and_attribute_at(console, offset % console->width, offset / console->width, c, attr);
 }
 
 void console_cursor_goto_xy(console_t console, unsigned x, unsigned y) {
@@ -343,6 +636,11 @@ void console_cursor_goto_xy(console_t console, unsigned x, unsigned y) {
     if(y >= console->height)
         y = console->height - 1;
     if(x!=console->cursor_x || y!=console->cursor_y) {
+        if(console->deferred) {
+            console->cursor_x = x;
+            console->cursor_y = y;
+            return;
+        }
         console_update_t u;
         u.type = CONSOLE_UPDATE_CURSOR_POSITION;
         u.data.u_cursor.cursor_visible = true;
@@ -359,49 +657,9 @@ void console_cursor_goto_xy(console_t console, unsigned x, unsigned y) {
 void console_scroll_lines(console_t console, unsigned n) {
     if(n == 0)
         return;
-    unsigned w = console->width;
-    unsigned h = console->height;
-
-    console_update_t u;
-    u.type = CONSOLE_UPDATE_CURSOR_VISIBILITY;
-    u.data.u_cursor.cursor_visible = false;
-    u.data.u_cursor.x = console->cursor_x;
-    u.data.u_cursor.y = console->cursor_y;
-    console->callback(console, &u, console->callback_data);
-
-    u.type = CONSOLE_UPDATE_SCROLL;
-    u.data.u_scroll.y1 = 0;
-    u.data.u_scroll.y2 = min(h, n);
-    u.data.u_scroll.n = h - min(h, n);
-    console->callback(console, &u, console->callback_data);
-
-    unsigned offset = n * w;
-    if(n < console->height) {
-        size_t bytes = (console->height - n) * w * sizeof(unsigned short);
-        memmove(console->buffer, console->buffer + offset, bytes);
-    }
-    if(n < h) {
-        offset = (h - n) * w;
-        n = n * w;
-        struct cell * buffer = console->buffer + offset;
-        for(; n > 0; --n, ++buffer) {
-            buffer->cell.character = 0;
-            buffer->cell.attribute = console->attribute;
-        }
-    } else {
-        n = h * w;
-        struct cell * buffer = console->buffer;
-        for(; n > 0; --n, ++buffer) {
-            buffer->cell.character = 0;
-            buffer->cell.attribute = console->attribute;
-        }
-    }
-
-    u.type = CONSOLE_UPDATE_CURSOR_VISIBILITY;
-    u.data.u_cursor.cursor_visible = console_cursor_is_shown(console);
-    u.data.u_cursor.x = console->cursor_x;
-    u.data.u_cursor.y = console->cursor_y;
-    console->callback(console, &u, console->callback_data);
+    console_update_scroll_begin(console, n);
+    console_scroll_buffer(console, n);
+    console_update_scroll_end(console);
 }
 
 unsigned console_get_width(console_t console) {
@@ -413,11 +671,11 @@ unsigned console_get_height(console_t console) {
 }
 
 unsigned console_get_char_width(console_t console) {
-    return console->char_width;
+    return console->char_width * console->font_scale;
 }
 
 unsigned console_get_char_height(console_t console) {
-    return console->char_height;
+    return console->char_height * console->font_scale;
 }
 
 unsigned console_get_cursor_x(console_t console) {
@@ -431,25 +689,25 @@ unsigned console_get_cursor_y(console_t console) {
 unsigned char console_get_character_at(console_t console, unsigned x, unsigned y) {
     if(x >= console->width || y >= console->height)
         return 0;
-    return console->buffer[y * console->width + x].cell.character;
+    return console_row(console, y)[x].cell.character;
 }
 
 unsigned char console_get_character_at_offset(console_t console, unsigned offset) {
     if(offset >= console->width * console->height)
         return 0;
-    return console->buffer[offset].cell.character;
+    return console_row(console, offset / console->width)[offset % console->width].cell.character;
 }
 
 unsigned char console_get_attribute_at(console_t console, unsigned x, unsigned y) {
     if(x >= console->width || y >= console->height)
         return 0;
-    return console->buffer[y * console->width + x].cell.attribute;
+    return console_row(console, y)[x].cell.attribute;
 }
 
 unsigned char console_get_attribute_at_offset(console_t console, unsigned offset) {
     if(offset >= console->width * console->height)
         return 0;
-    return console->buffer[offset].cell.attribute;
+    return console_row(console, offset / console->width)[offset % console->width].cell.attribute;
 }
 
 unsigned char console_get_background_color(console_t console) {
@@ -461,13 +719,12 @@ unsigned char console_get_foreground_color(console_t console) {
 }
 
 unsigned char * console_get_char_bitmap(console_t console, unsigned char c) {
-    unsigned bytes_per_row = (console->char_width + 7) / 8;
-    unsigned bytes_per_char = bytes_per_row * console->char_height;
-    unsigned offset = c * bytes_per_char;
-    return &console_fonts[console->font_id].font_bitmap[offset];
+    return (unsigned char *)console_glyph(console, c);
 }
 
 void console_set_mode(console_t console, console_mode mode) {
+    if(mode == CONSOLE_MODE_ANSI && console->mode != CONSOLE_MODE_ANSI)
+        console_ansi_reset(console);
     console->mode = mode;
 }
 
@@ -481,3 +738,127 @@ void console_refresh(console_t console) {
     console->callback(console, &u, console->callback_data);
 }
 
+
+static void console_damage_reset(console_t console) {
+    console->dirty = realloc(console->dirty, console->height * sizeof(struct span));
+    memset(console->dirty, 0, console->height * sizeof(struct span));
+    console->pending_scroll = 0;
+    console->flushed_cursor_x = console->cursor_x;
+    console->flushed_cursor_y = console->cursor_y;
+    console->flushed_cursor_shown = console_cursor_is_shown(console);
+}
+
+void console_set_deferred_updates(console_t console, bool deferred) {
+    if(console->deferred == deferred)
+        return;
+    if(deferred) {
+        console_damage_reset(console);
+        console->deferred = true;
+    } else {
+        console_flush(console);
+        console->deferred = false;
+    }
+}
+
+bool console_get_deferred_updates(console_t console) {
+    return console->deferred;
+}
+
+void console_flush(console_t console) {
+    if(!console->deferred)
+        return;
+
+    console_update_t u;
+    unsigned h = console->height;
+    unsigned scroll = console->pending_scroll;
+    bool shown = console_cursor_is_shown(console);
+
+    if(scroll > 0) {
+        /*
+         * The buffer has already scrolled, so hiding the cursor where it was
+         * would repaint that cell from the wrong row. Its image moves up with
+         * the scroll and is repainted there as damage instead.
+         */
+        unsigned x = console->flushed_cursor_x;
+        if(console->flushed_cursor_shown && x < console->width && console->flushed_cursor_y >= scroll)
+            console_damage(console, x, console->flushed_cursor_y - scroll, x + 1);
+
+        u.type = CONSOLE_UPDATE_SCROLL;
+        u.data.u_scroll.y1 = 0;
+        u.data.u_scroll.y2 = scroll;
+        u.data.u_scroll.n = h - scroll;
+        console->callback(console, &u, console->callback_data);
+    }
+
+    /* coalesce runs of consecutive dirty rows into one event each */
+    unsigned y = 0;
+    while(y < h) {
+        struct span * span = &console->dirty[y];
+        if(span->x1 >= span->x2) {
+            ++y;
+            continue;
+        }
+        u.type = CONSOLE_UPDATE_ROWS;
+        u.data.u_rows.x1 = span->x1;
+        u.data.u_rows.x2 = span->x2;
+        u.data.u_rows.y1 = y;
+        for(; y < h && span->x1 < span->x2; ++y, ++span) {
+            u.data.u_rows.x1 = min(u.data.u_rows.x1, span->x1);
+            u.data.u_rows.x2 = max(u.data.u_rows.x2, span->x2);
+            span->x1 = span->x2 = 0;
+        }
+        u.data.u_rows.y2 = y;
+        console->callback(console, &u, console->callback_data);
+    }
+
+    if(scroll == 0 && (console->cursor_x != console->flushed_cursor_x || console->cursor_y != console->flushed_cursor_y)) {
+        u.type = CONSOLE_UPDATE_CURSOR_POSITION;
+        u.data.u_cursor.cursor_visible = true;
+        u.data.u_cursor.x = console->flushed_cursor_x;
+        u.data.u_cursor.y = console->flushed_cursor_y;
+        console->callback(console, &u, console->callback_data);
+    }
+    if(scroll > 0 || shown != console->flushed_cursor_shown) {
+        u.type = CONSOLE_UPDATE_CURSOR_VISIBILITY;
+        u.data.u_cursor.cursor_visible = shown;
+        u.data.u_cursor.x = console->cursor_x;
+        u.data.u_cursor.y = console->cursor_y;
+        console->callback(console, &u, console->callback_data);
+    }
+
+    console->pending_scroll = 0;
+    console->flushed_cursor_x = console->cursor_x;
+    console->flushed_cursor_y = console->cursor_y;
+    console->flushed_cursor_shown = shown;
+    console_snapshot_publish(console);
+}
+
+void console_set_view_offset(console_t console, unsigned lines) {
+    if(lines > console->scrollback_count)
+        lines = console->scrollback_count;
+    if(console->view_offset == lines)
+        return;
+    console->view_offset = lines;
+    console_update_rows(console, 0, 0, console->width, console->height);
+}
+
+unsigned console_get_view_offset(console_t console) {
+    return console->view_offset;
+}
+
+/* new output snaps a scrolled back view to the live screen */
+static void console_view_follow(console_t console) {
+    if(console->view_offset > 0)
+        console_set_view_offset(console, 0);
+}
+
+const unsigned short * console_get_view_row(console_t console, unsigned y) {
+    if(y >= console->height)
+        return NULL;
+    return (const unsigned short *)console_view_row(console, y);
+}
+
+void console_damage_rows(console_t console, unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    console_view_follow(console);
+    console_update_rows(console, x1, y1, x2, y2);
+}
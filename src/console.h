@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,13 +51,16 @@ typedef struct {
             unsigned y2;
             unsigned n;
         } u_scroll;
+        /* followed by ROWS updates covering the cells drawn in a changed colour */
         struct {
             console_rgb_t * palette;
+            unsigned short changed;    /* bit per palette index */
         } u_palette;
         struct {
             unsigned char_width;
             unsigned char_height;
             unsigned char * font_bitmap;
+            unsigned scale;
         } u_font;
         struct {
             unsigned x;
@@ -66,6 +70,12 @@ typedef struct {
     } data;
 } console_update_t;
 
+/* cells [x1, x2) of a row, empty while x1 >= x2 */
+typedef struct {
+    unsigned x1;
+    unsigned x2;
+} console_span_t;
+
 /* Color indices */
 #define CONSOLE_BLACK          0
 #define CONSOLE_BLUE           1
@@ -86,21 +96,29 @@ typedef struct {
 
 struct console;
 typedef struct console * console_t;
+struct console_snapshot;
+typedef const struct console_snapshot * console_snapshot_t;
+struct console_group;
+typedef struct console_group * console_group_t;
+typedef void (*console_group_render_t)(console_t console, void * data);
 typedef void (*console_callback_t)(console_t console, console_update_t * p, void * data);
 
 #define CONSOLE_NUM_PALETTE_ENTRIES 16
 
 #include "font.h"
+#include "render.h"
 
 console_t console_alloc(unsigned width, unsigned height, font_id_t font);
 void console_free(console_t console);
 void console_clear(console_t console);
 unsigned short * console_get_raw_buffer(console_t console);
+void console_linearize(console_t console);
 void console_set_mode(console_t console, console_mode mode);
 console_mode console_get_mode(console_t console);
 void console_set_tab_width(console_t console, unsigned width);
 unsigned console_get_tab_width(console_t console);
 void console_print_char(console_t console, unsigned char c);
+void console_write(console_t console, const unsigned char * buf, size_t len);
 void console_cursor_goto_xy(console_t console, unsigned x, unsigned y);
 void console_save_cursor_position(console_t console);
 void console_restore_cursor_position(console_t console);
@@ -126,6 +144,13 @@ void console_set_palette(console_t console, console_rgb_t const * palette);
 void console_get_palette(console_t console, console_rgb_t * palette);
 void console_set_font(console_t console, font_id_t font);
 font_id_t console_get_font(console_t console);
+void console_set_font_data(console_t console, const font_t * font);
+const font_t * console_get_font_data(console_t console);
+#define CONSOLE_MAX_FONT_SCALE 4
+void console_set_font_scale(console_t console, unsigned scale);
+unsigned console_get_font_scale(console_t console);
+void console_set_packed_glyphs(console_t console, bool packed);
+bool console_get_packed_glyphs(console_t console);
 unsigned char * console_get_char_bitmap(console_t console, unsigned char c);
 void console_set_callback(console_t console, console_callback_t callback, void * data);
 void console_set_cursor_blink_rate(console_t console, unsigned rate);
@@ -134,6 +159,96 @@ void console_blink_cursor(console_t console);
 void console_show_cursor(console_t console);
 void console_hide_cursor(console_t console);
 void console_refresh(console_t console);
+void console_set_deferred_updates(console_t console, bool deferred);
+bool console_get_deferred_updates(console_t console);
+void console_flush(console_t console);
+void console_set_scrollback_rows(console_t console, unsigned rows);
+void console_set_scrollback_bytes(console_t console, size_t bytes);
+unsigned console_get_scrollback_capacity(console_t console);
+unsigned console_get_scrollback_count(console_t console);
+void console_clear_scrollback(console_t console);
+const unsigned short * console_get_scrollback_row(console_t console, unsigned back);
+void console_set_view_offset(console_t console, unsigned lines);
+unsigned console_get_view_offset(console_t console);
+const unsigned short * console_get_view_row(console_t console, unsigned y);
+
+/*
+ * Input queue for feeding a console from another thread. One producer
+ * thread calls console_enqueue and console_queue_space, one consumer
+ * thread, the one that owns the console, calls console_drain and
+ * console_queue_pending; neither blocks. console_enqueue returns the
+ * number of bytes accepted, which is less than len while the queue is
+ * full. console_drain writes up to max queued bytes with console_write
+ * and returns how many it took. The size is rounded up to a power of two
+ * and must be set while no other thread uses the queue, 0 removes it.
+ */
+void console_set_queue_size(console_t console, size_t bytes);
+size_t console_get_queue_size(console_t console);
+size_t console_enqueue(console_t console, const unsigned char * buf, size_t len);
+size_t console_queue_space(console_t console);
+size_t console_queue_pending(console_t console);
+size_t console_drain(console_t console, size_t max);
+
+/*
+ * Read-only copies of the view, cursor, palette and font for a render
+ * thread. The thread that owns the console publishes a snapshot with
+ * console_snapshot_publish, console_flush does so too. Another thread
+ * takes the newest one with console_snapshot_acquire, NULL before the
+ * first is published, and keeps it until console_snapshot_release. There
+ * is one reader thread; acquiring again before releasing returns the same
+ * snapshot, release each acquire. Only rows changed since a buffer was
+ * last used are copied. Enable snapshots while no other thread uses the
+ * console.
+ */
+void console_set_snapshots(console_t console, bool enabled);
+bool console_get_snapshots(console_t console);
+void console_snapshot_publish(console_t console);
+console_snapshot_t console_snapshot_acquire(console_t console);
+void console_snapshot_release(console_t console, console_snapshot_t snapshot);
+uint64_t console_snapshot_get_generation(console_snapshot_t snapshot);
+unsigned console_snapshot_get_width(console_snapshot_t snapshot);
+unsigned console_snapshot_get_height(console_snapshot_t snapshot);
+const unsigned short * console_snapshot_get_row(console_snapshot_t snapshot, unsigned y);
+unsigned console_snapshot_get_cursor_x(console_snapshot_t snapshot);
+unsigned console_snapshot_get_cursor_y(console_snapshot_t snapshot);
+bool console_snapshot_cursor_is_shown(console_snapshot_t snapshot);
+void console_snapshot_get_palette(console_snapshot_t snapshot, console_rgb_t * palette);
+const font_t * console_snapshot_get_font(console_snapshot_t snapshot);
+unsigned console_snapshot_get_font_scale(console_snapshot_t snapshot);
+
+/*
+ * Group of consoles sharing a work-stealing thread pool, threads 0 uses
+ * one per online CPU. console_schedule queues a console of a group to
+ * drain its input queue, call its render function, if any, and flush,
+ * callbacks included, on a pool thread. The render function sees the
+ * damage of the whole batch, so it can use console_render_bands. Schedule
+ * from any thread, typically the producer after console_enqueue. A
+ * console never runs on two threads at once, work scheduled while it runs
+ * makes it run again afterwards. Add and remove consoles from the thread
+ * that created the group and leave them alone while they are in it except
+ * for enqueueing and scheduling. Removing a console waits for its own
+ * task only, and must not be done from it; scheduling it after it is
+ * removed does nothing. console_free removes it too.
+ */
+console_group_t console_group_alloc(unsigned threads);
+void console_group_free(console_group_t group);
+unsigned console_group_get_threads(console_group_t group);
+bool console_group_add(console_group_t group, console_t console, console_group_render_t render, void * data);
+void console_group_remove(console_group_t group, console_t console);
+void console_schedule(console_t console);
+void console_group_schedule_all(console_group_t group);
+void console_group_wait(console_group_t group);
+
+/*
+ * Compares the view with a copy of it kept from the previous call and
+ * fills spans, one per view row, with the cells changed since, including
+ * the cells the cursor left and moved to. Returns the number of rows with
+ * changes. Unlike the update callbacks this also sees writes through
+ * console_get_raw_buffer. The first call, and the first after a font
+ * change, reports every cell. Palette changes leave the cells alone and
+ * are not reported.
+ */
+unsigned console_diff(console_t console, console_span_t * spans);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,85 @@
+#include "console.h"
+#include "console-private.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The shadow is the view as of the last console_diff, row by row in view
+ * order. Comparing against it finds changes however they were made,
+ * including writes through console_get_raw_buffer, at the price of reading
+ * the whole view each time.
+ */
+
+void console_diff_free(console_t console) {
+    free(console->shadow);
+    console->shadow = NULL;
+}
+
+/* y is a live row, drawn view_offset rows down */
+static void console_diff_cursor(console_t console, console_span_t * spans, unsigned x, unsigned y,
+        unsigned view_offset) {
+    y += view_offset;
+    if(x >= console->width || y >= console->height)
+        return;
+    console_span_t * span = &spans[y];
+    if(span->x1 >= span->x2) {
+        span->x1 = x;
+        span->x2 = x + 1;
+        return;
+    }
+    span->x1 = min(span->x1, x);
+    span->x2 = max(span->x2, x + 1);
+}
+
+unsigned console_diff(console_t console, console_span_t * spans) {
+    unsigned w = console->width;
+    unsigned h = console->height;
+    size_t row_bytes = w * sizeof(struct cell);
+    unsigned y, changed = 0;
+    bool shown = console_cursor_is_shown(console);
+
+    if(!console->shadow) {
+        /* the first diff after allocation or a font change has nothing to compare with */
+        console->shadow = malloc((size_t)w * h * sizeof(struct cell));
+        for(y = 0; y < h; ++y) {
+            spans[y].x1 = 0;
+            spans[y].x2 = w;
+            if(console->shadow)
+                memcpy(console->shadow + (size_t)y * w, console_view_row(console, y), row_bytes);
+        }
+        changed = w > 0 ? h : 0;
+    } else {
+        for(y = 0; y < h; ++y) {
+            const struct cell * live = console_view_row(console, y);
+            struct cell * shadow = console->shadow + (size_t)y * w;
+            size_t first, last;
+            if(!console_diff_cells(&live->cell_data, &shadow->cell_data, w, &first, &last)) {
+                spans[y].x1 = spans[y].x2 = 0;
+                continue;
+            }
+            spans[y].x1 = (unsigned)first;
+            spans[y].x2 = (unsigned)last + 1;
+            memcpy(shadow + first, live + first, (last + 1 - first) * sizeof(struct cell));
+            ++changed;
+        }
+        /* the cursor is drawn over its cell, so moving it changes two cells */
+        if(shown != console->shadow_cursor_shown || console->cursor_x != console->shadow_cursor_x ||
+                console->cursor_y != console->shadow_cursor_y ||
+                console->view_offset != console->shadow_view_offset) {
+            if(console->shadow_cursor_shown)
+                console_diff_cursor(console, spans, console->shadow_cursor_x, console->shadow_cursor_y,
+                        console->shadow_view_offset);
+            if(shown)
+                console_diff_cursor(console, spans, console->cursor_x, console->cursor_y, console->view_offset);
+            changed = 0;
+            for(y = 0; y < h; ++y)
+                changed += spans[y].x1 < spans[y].x2;
+        }
+    }
+    console->shadow_cursor_x = console->cursor_x;
+    console->shadow_cursor_y = console->cursor_y;
+    console->shadow_view_offset = console->view_offset;
+    console->shadow_cursor_shown = shown;
+    return changed;
+}
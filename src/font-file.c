@@ -0,0 +1,129 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * header layout, all fields little endian:
+ *   0  magic "CFNT"
+ *   4  u16 version
+ *   6  u16 header size
+ *   8  u32 char width
+ *  12  u32 char height
+ *  16  u32 glyph count
+ *  20  u32 stride, bytes per glyph row
+ *  24  u32 bitmap offset
+ *  28  char name[32], NUL padded
+ *  60  reserved
+ */
+
+static uint32_t console_font_get32(const unsigned char * p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void console_font_put32(unsigned char * p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+font_t * console_font_load(const char * path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if(st.st_size < CONSOLE_FONT_HEADER_SIZE) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    /* private read-only mapping: page cache is shared, glyphs fault in on first use */
+    void * map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return NULL;
+
+    const unsigned char * h = map;
+    unsigned version = h[4] | (h[5] << 8);
+    unsigned width = console_font_get32(h + 8);
+    unsigned height = console_font_get32(h + 12);
+    unsigned count = console_font_get32(h + 16);
+    unsigned stride = console_font_get32(h + 20);
+    size_t offset = console_font_get32(h + 24);
+    /* the renderers assume glyphs of at most 255 pixels, like the importers */
+    if(memcmp(h, CONSOLE_FONT_MAGIC, 4) || version != CONSOLE_FONT_VERSION ||
+            width == 0 || height == 0 || count == 0 || width > 255 || height > 255 ||
+            stride != (width + 7) / 8 || offset < CONSOLE_FONT_HEADER_SIZE || offset > size ||
+            count > (size - offset) / ((size_t)height * stride)) {
+        munmap(map, size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct font_file * file = calloc(1, sizeof(struct font_file));
+    if(!file) {
+        munmap(map, size);
+        return NULL;
+    }
+    file->map = map;
+    file->map_size = size;
+    memcpy(file->name, h + 28, CONSOLE_FONT_NAME_SIZE);
+    file->font.char_width = width;
+    file->font.char_height = height;
+    file->font.font_name = file->name;
+    file->font.font_bitmap = (unsigned char *)map + offset;
+    file->font.glyph_count = count;
+    return &file->font;
+}
+
+void console_font_free(font_t * font) {
+    if(font) {
+        struct font_file * file = (struct font_file *)font;
+        if(file->map)
+            munmap(file->map, file->map_size);
+        else
+            free(file->font.font_bitmap);
+        free(file);
+    }
+}
+
+int console_font_save(const font_t * font, const char * path) {
+    unsigned char h[CONSOLE_FONT_HEADER_SIZE];
+    unsigned stride = (font->char_width + 7) / 8;
+    size_t bytes = (size_t)font->glyph_count * font->char_height * stride;
+
+    memset(h, 0, sizeof(h));
+    memcpy(h, CONSOLE_FONT_MAGIC, 4);
+    h[4] = CONSOLE_FONT_VERSION;
+    h[6] = CONSOLE_FONT_HEADER_SIZE;
+    console_font_put32(h + 8, font->char_width);
+    console_font_put32(h + 12, font->char_height);
+    console_font_put32(h + 16, font->glyph_count);
+    console_font_put32(h + 20, stride);
+    console_font_put32(h + 24, CONSOLE_FONT_HEADER_SIZE);
+    if(font->font_name)
+        strncpy((char *)h + 28, font->font_name, CONSOLE_FONT_NAME_SIZE);
+
+    FILE * f = fopen(path, "wb");
+    if(!f)
+        return -1;
+    if(fwrite(h, sizeof(h), 1, f) != 1 || fwrite(font->font_bitmap, 1, bytes, f) != bytes) {
+        fclose(f);
+        return -1;
+    }
+    return fclose(f) ? -1 : 0;
+}
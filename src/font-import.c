@@ -0,0 +1,192 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+
+#define PSF2_MAGIC "\x72\xb5\x4a\x86"
+#define PSF2_HEADER_SIZE 32
+
+/* glyphs past the first 256 can never be addressed by a cell */
+#define IMPORT_MAX_GLYPHS 256
+
+static struct font_file * console_font_import_alloc(unsigned width, unsigned height, unsigned count,
+        const char * name) {
+    struct font_file * file = calloc(1, sizeof(struct font_file));
+    if(!file)
+        return NULL;
+    file->font.font_bitmap = calloc((size_t)count * height, (width + 7) / 8);
+    if(!file->font.font_bitmap) {
+        free(file);
+        return NULL;
+    }
+    snprintf(file->name, sizeof(file->name), "%s", name);
+    file->font.char_width = width;
+    file->font.char_height = height;
+    file->font.glyph_count = count;
+    file->font.font_name = file->name;
+    return file;
+}
+
+static uint32_t console_psf2_get32(const unsigned char * p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static font_t * console_font_import_psf2(FILE * f, const char * name) {
+    unsigned char h[PSF2_HEADER_SIZE];
+    if(fread(h, sizeof(h), 1, f) != 1 || memcmp(h, PSF2_MAGIC, 4)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    uint32_t header_size = console_psf2_get32(h + 8);
+    uint32_t count = console_psf2_get32(h + 16);
+    uint32_t charsize = console_psf2_get32(h + 20);
+    uint32_t height = console_psf2_get32(h + 24);
+    uint32_t width = console_psf2_get32(h + 28);
+    /* PSF2 rows are padded to whole bytes, the same layout as ours */
+    if(header_size < PSF2_HEADER_SIZE || count == 0 || width == 0 || height == 0 ||
+            width > 255 || height > 255 || charsize != (width + 7) / 8 * height) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if(count > IMPORT_MAX_GLYPHS)
+        count = IMPORT_MAX_GLYPHS;
+
+    struct font_file * file = console_font_import_alloc(width, height, count, name);
+    if(!file)
+        return NULL;
+    if(fseek(f, header_size, SEEK_SET) || fread(file->font.font_bitmap, charsize, count, f) != count) {
+        console_font_free(&file->font);
+        errno = EINVAL;
+        return NULL;
+    }
+    return &file->font;
+}
+
+static bool console_bdf_keyword(const char * line, const char * keyword) {
+    size_t n = strlen(keyword);
+    return !strncmp(line, keyword, n) && (line[n] == ' ' || line[n] == '\n' || line[n] == '\r' || !line[n]);
+}
+
+/* the cell is the font bounding box, glyphs are placed relative to its origin */
+static font_t * console_font_import_bdf(FILE * f, const char * name) {
+    char line[512];
+    int fbb_w = 0, fbb_h = 0, fbb_x = 0, fbb_y = 0;
+    char font_name[CONSOLE_FONT_NAME_SIZE + 1];
+    snprintf(font_name, sizeof(font_name), "%s", name);
+
+    if(!fgets(line, sizeof(line), f) || !console_bdf_keyword(line, "STARTFONT")) {
+        errno = EINVAL;
+        return NULL;
+    }
+    while(fgets(line, sizeof(line), f)) {
+        if(console_bdf_keyword(line, "FONTBOUNDINGBOX")) {
+            sscanf(line + 15, "%d %d %d %d", &fbb_w, &fbb_h, &fbb_x, &fbb_y);
+        } else if(console_bdf_keyword(line, "FAMILY_NAME")) {
+            char * q = strchr(line, '"');
+            char * e = q ? strrchr(q + 1, '"') : NULL;
+            if(e) {
+                *e = 0;
+                snprintf(font_name, sizeof(font_name), "%s (%dx%d)", q + 1, fbb_w, fbb_h);
+            }
+        } else if(console_bdf_keyword(line, "CHARS")) {
+            break;
+        }
+    }
+    if(fbb_w <= 0 || fbb_h <= 0 || fbb_w > 255 || fbb_h > 255) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    unsigned width = fbb_w, height = fbb_h;
+    unsigned bytes_per_row = (width + 7) / 8;
+    struct font_file * file = console_font_import_alloc(width, height, IMPORT_MAX_GLYPHS, font_name);
+    if(!file)
+        return NULL;
+    if(fbb_h + fbb_y > 0 && fbb_h + fbb_y <= fbb_h)
+        file->font.baseline = fbb_h + fbb_y;
+
+    int encoding = -1, bw = 0, bh = 0, bx = 0, by = 0, row = 0;
+    bool bitmap = false;
+    while(fgets(line, sizeof(line), f)) {
+        if(console_bdf_keyword(line, "ENCODING")) {
+            encoding = atoi(line + 8);
+        } else if(console_bdf_keyword(line, "BBX")) {
+            sscanf(line + 3, "%d %d %d %d", &bw, &bh, &bx, &by);
+        } else if(console_bdf_keyword(line, "BITMAP")) {
+            /* first bitmap row sits this many rows below the top of the cell */
+            row = (fbb_h + fbb_y) - (by + bh);
+            bitmap = true;
+        } else if(console_bdf_keyword(line, "ENDCHAR")) {
+            encoding = -1;
+            bitmap = false;
+        } else if(console_bdf_keyword(line, "ENDFONT")) {
+            break;
+        } else if(bitmap) {
+            if(encoding < 0 || encoding >= IMPORT_MAX_GLYPHS) {
+                ++row;
+                continue;
+            }
+            unsigned char * glyph = file->font.font_bitmap + (size_t)encoding * bytes_per_row * height;
+            int col = bx - fbb_x;
+            int x;
+            const char * p = line;
+            for(x = 0; x < bw; x += 4, ++p) {
+                int nibble;
+                if(*p >= '0' && *p <= '9')
+                    nibble = *p - '0';
+                else if(*p >= 'a' && *p <= 'f')
+                    nibble = *p - 'a' + 10;
+                else if(*p >= 'A' && *p <= 'F')
+                    nibble = *p - 'A' + 10;
+                else
+                    break;
+                int b;
+                for(b = 0; b < 4 && x + b < bw; ++b) {
+                    int px = col + x + b;
+                    if(!(nibble & (8 >> b)) || row < 0 || row >= fbb_h || px < 0 || px >= fbb_w)
+                        continue;
+                    glyph[row * bytes_per_row + (px >> 3)] |= 0x80 >> (px & 7);
+                }
+            }
+            ++row;
+        }
+    }
+    if(ferror(f)) {
+        console_font_free(&file->font);
+        errno = EIO;
+        return NULL;
+    }
+    return &file->font;
+}
+
+font_t * console_font_open(const char * path) {
+    FILE * f = fopen(path, "rb");
+    if(!f)
+        return NULL;
+    char magic[9];
+    size_t n = fread(magic, 1, sizeof(magic), f);
+    rewind(f);
+
+    const char * name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    font_t * font;
+    if(n >= 4 && !memcmp(magic, CONSOLE_FONT_MAGIC, 4)) {
+        fclose(f);
+        return console_font_load(path);
+    } else if(n >= 4 && !memcmp(magic, PSF2_MAGIC, 4)) {
+        font = console_font_import_psf2(f, name);
+    } else if(n >= 9 && !memcmp(magic, "STARTFONT", 9)) {
+        font = console_font_import_bdf(f, name);
+    } else {
+        errno = EINVAL;
+        font = NULL;
+    }
+    int err = errno;
+    fclose(f);
+    errno = err;
+    return font;
+}
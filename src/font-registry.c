@@ -0,0 +1,199 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+struct font_entry {
+    struct font_entry * next;
+    const font_t * font;
+    unsigned refs;
+    bool named;
+    bool builtin;                   /* never unregistered */
+    void (*release)(font_t * font);
+    void * derived[CONSOLE_FONT_DERIVED_SLOTS];
+    void (*derived_free[CONSOLE_FONT_DERIVED_SLOTS])(void * data);
+};
+
+static pthread_mutex_t g_font_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct font_entry * g_fonts;
+static bool g_builtin_registered;
+
+static struct font_entry * console_font_entry_add(const font_t * font, bool named,
+        void (*release)(font_t * font)) {
+    struct font_entry * e = calloc(1, sizeof(struct font_entry));
+    if(!e)
+        return NULL;
+    e->font = font;
+    e->named = named;
+    e->release = release;
+    /* keep registration order so the built-in fonts win size lookups */
+    struct font_entry ** p = &g_fonts;
+    while(*p)
+        p = &(*p)->next;
+    *p = e;
+    return e;
+}
+
+/* called with g_font_lock held */
+static void console_font_register_builtin(void) {
+    if(g_builtin_registered)
+        return;
+    g_builtin_registered = true;
+    unsigned i;
+    for(i = 0; i < CONSOLE_NUM_FONTS; ++i) {
+        struct font_entry * e = console_font_entry_add(&console_fonts[i], true, NULL);
+        if(e) {
+            e->builtin = true;
+            e->refs = 1;
+        }
+    }
+}
+
+static struct font_entry * console_font_find(const font_t * font) {
+    struct font_entry * e;
+    for(e = g_fonts; e; e = e->next)
+        if(e->font == font)
+            return e;
+    return NULL;
+}
+
+static struct font_entry * console_font_find_name(const char * name) {
+    struct font_entry * e;
+    for(e = g_fonts; e; e = e->next)
+        if(e->named && e->font->font_name && !strcmp(e->font->font_name, name))
+            return e;
+    return NULL;
+}
+
+/* called with g_font_lock held, release must not call back into the registry */
+static void console_font_put(struct font_entry * e) {
+    if(--e->refs > 0)
+        return;
+    struct font_entry ** p = &g_fonts;
+    while(*p != e)
+        p = &(*p)->next;
+    *p = e->next;
+    unsigned i;
+    for(i = 0; i < CONSOLE_FONT_DERIVED_SLOTS; ++i)
+        if(e->derived[i] && e->derived_free[i])
+            e->derived_free[i](e->derived[i]);
+    if(e->release)
+        e->release((font_t *)e->font);
+    free(e);
+}
+
+int console_font_register(const font_t * font, void (*release)(font_t * font)) {
+    int ret = 0;
+    if(!font) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock(&g_font_lock);
+    console_font_register_builtin();
+    struct font_entry * e = console_font_find(font);
+    if(!font->font_name || console_font_find_name(font->font_name) || (e && e->named)) {
+        errno = EEXIST;
+        ret = -1;
+    } else if(e) {
+        /* already in use by a console, take it over */
+        e->named = true;
+        e->release = release;
+        ++e->refs;
+    } else if((e = console_font_entry_add(font, true, release))) {
+        e->refs = 1;
+    } else {
+        ret = -1;
+    }
+    pthread_mutex_unlock(&g_font_lock);
+    return ret;
+}
+
+int console_font_unregister(const char * name) {
+    int ret = 0;
+    pthread_mutex_lock(&g_font_lock);
+    console_font_register_builtin();
+    struct font_entry * e = console_font_find_name(name);
+    if(!e || e->builtin) {
+        errno = e ? EPERM : ENOENT;
+        ret = -1;
+    } else {
+        e->named = false;
+        console_font_put(e);
+    }
+    pthread_mutex_unlock(&g_font_lock);
+    return ret;
+}
+
+const font_t * console_font_lookup(const char * name) {
+    const font_t * font = NULL;
+    pthread_mutex_lock(&g_font_lock);
+    console_font_register_builtin();
+    struct font_entry * e = console_font_find_name(name);
+    if(e) {
+        ++e->refs;
+        font = e->font;
+    }
+    pthread_mutex_unlock(&g_font_lock);
+    return font;
+}
+
+const font_t * console_font_lookup_size(unsigned char_width, unsigned char_height) {
+    const font_t * font = NULL;
+    pthread_mutex_lock(&g_font_lock);
+    console_font_register_builtin();
+    struct font_entry * e;
+    for(e = g_fonts; e; e = e->next) {
+        if(e->named && e->font->char_width == char_width && e->font->char_height == char_height) {
+            ++e->refs;
+            font = e->font;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_font_lock);
+    return font;
+}
+
+int console_font_acquire(const font_t * font) {
+    int ret = 0;
+    pthread_mutex_lock(&g_font_lock);
+    console_font_register_builtin();
+    struct font_entry * e = console_font_find(font);
+    /* unregistered fonts get an anonymous entry so derived caches can hang off it */
+    if(!e)
+        e = console_font_entry_add(font, false, NULL);
+    if(e)
+        ++e->refs;
+    else
+        ret = -1;
+    pthread_mutex_unlock(&g_font_lock);
+    return ret;
+}
+
+void console_font_release(const font_t * font) {
+    if(!font)
+        return;
+    pthread_mutex_lock(&g_font_lock);
+    struct font_entry * e = console_font_find(font);
+    if(e)
+        console_font_put(e);
+    pthread_mutex_unlock(&g_font_lock);
+}
+
+void * console_font_derived(const font_t * font, unsigned slot,
+        void * (*create)(const font_t * font), void (*destroy)(void * data)) {
+    void * data = NULL;
+    pthread_mutex_lock(&g_font_lock);
+    struct font_entry * e = console_font_find(font);
+    if(e) {
+        if(!e->derived[slot]) {
+            e->derived[slot] = create(font);
+            e->derived_free[slot] = destroy;
+        }
+        data = e->derived[slot];
+    }
+    pthread_mutex_unlock(&g_font_lock);
+    return data;
+}
@@ -87,7 +87,8 @@ const font_t console_fonts[] = {
         .char_width = 4,
         .char_height = 6,
         .font_name = "4x6",
-        .font_bitmap = &console_font_4x6[0]
+        .font_bitmap = &console_font_4x6[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_4x7
@@ -95,7 +96,8 @@ const font_t console_fonts[] = {
         .char_width = 4,
         .char_height = 7,
         .font_name = "4x7",
-        .font_bitmap = &console_font_4x7[0]
+        .font_bitmap = &console_font_4x7[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_5x8
@@ -103,7 +105,8 @@ const font_t console_fonts[] = {
         .char_width = 5,
         .char_height = 8,
         .font_name = "5x8",
-        .font_bitmap = &console_font_5x8[0]
+        .font_bitmap = &console_font_5x8[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_5x12
@@ -111,7 +114,8 @@ const font_t console_fonts[] = {
         .char_width = 5,
         .char_height = 12,
         .font_name = "5x12",
-        .font_bitmap = &console_font_5x12[0]
+        .font_bitmap = &console_font_5x12[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_6x8
@@ -119,7 +123,8 @@ const font_t console_fonts[] = {
         .char_width = 6,
         .char_height = 8,
         .font_name = "6x8",
-        .font_bitmap = &console_font_6x8[0]
+        .font_bitmap = &console_font_6x8[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_7x9
@@ -127,7 +132,8 @@ const font_t console_fonts[] = {
         .char_width = 7,
         .char_height = 9,
         .font_name = "7x9",
-        .font_bitmap = &console_font_7x9[0]
+        .font_bitmap = &console_font_7x9[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_8x8
@@ -135,7 +141,8 @@ const font_t console_fonts[] = {
         .char_width = 8,
         .char_height = 8,
         .font_name = "System (8x8)",
-        .font_bitmap = &console_font_8x8[0]
+        .font_bitmap = &console_font_8x8[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_8x10
@@ -143,7 +150,8 @@ const font_t console_fonts[] = {
         .char_width = 8,
         .char_height = 10,
         .font_name = "System (8x10)",
-        .font_bitmap = &console_font_8x10[0]
+        .font_bitmap = &console_font_8x10[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_8x16
@@ -151,7 +159,8 @@ const font_t console_fonts[] = {
         .char_width = 8,
         .char_height = 16,
         .font_name = "System (8x16)",
-        .font_bitmap = &console_font_8x16[0]
+        .font_bitmap = &console_font_8x16[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_9x8
@@ -159,7 +168,8 @@ const font_t console_fonts[] = {
         .char_width = 9,
         .char_height = 8,
         .font_name = "9x8",
-        .font_bitmap = &console_font_9x8[0]
+        .font_bitmap = &console_font_9x8[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_9x16
@@ -167,7 +177,8 @@ const font_t console_fonts[] = {
         .char_width = 9,
         .char_height = 16,
         .font_name = "9x16",
-        .font_bitmap = &console_font_9x16[0]
+        .font_bitmap = &console_font_9x16[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_10x20
@@ -175,7 +186,8 @@ const font_t console_fonts[] = {
         .char_width = 10,
         .char_height = 20,
         .font_name = "10x20",
-        .font_bitmap = &console_font_10x20[0]
+        .font_bitmap = &console_font_10x20[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_12x16
@@ -183,7 +195,8 @@ const font_t console_fonts[] = {
         .char_width = 12,
         .char_height = 16,
         .font_name = "12x16",
-        .font_bitmap = &console_font_12x16[0]
+        .font_bitmap = &console_font_12x16[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_12x23
@@ -191,7 +204,8 @@ const font_t console_fonts[] = {
         .char_width = 12,
         .char_height = 23,
         .font_name = "12x23",
-        .font_bitmap = &console_font_12x23[0]
+        .font_bitmap = &console_font_12x23[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_12x24
@@ -199,7 +213,8 @@ const font_t console_fonts[] = {
         .char_width = 12,
         .char_height = 24,
         .font_name = "12x24",
-        .font_bitmap = &console_font_12x24[0]
+        .font_bitmap = &console_font_12x24[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_12x27
@@ -207,7 +222,8 @@ const font_t console_fonts[] = {
         .char_width = 12,
         .char_height = 27,
         .font_name = "12x27",
-        .font_bitmap = &console_font_12x27[0]
+        .font_bitmap = &console_font_12x27[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_14x30
@@ -215,7 +231,8 @@ const font_t console_fonts[] = {
         .char_width = 14,
         .char_height = 30,
         .font_name = "14x30",
-        .font_bitmap = &console_font_14x30[0]
+        .font_bitmap = &console_font_14x30[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_16x32
@@ -223,7 +240,8 @@ const font_t console_fonts[] = {
         .char_width = 16,
         .char_height = 32,
         .font_name = "16x32",
-        .font_bitmap = &console_font_16x32[0]
+        .font_bitmap = &console_font_16x32[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_16x37
@@ -231,7 +249,8 @@ const font_t console_fonts[] = {
         .char_width = 16,
         .char_height = 37,
         .font_name = "16x37",
-        .font_bitmap = &console_font_16x37[0]
+        .font_bitmap = &console_font_16x37[0],
+        .glyph_count = 256
     },
 #endif
 #ifdef CONSOLE_USE_FONT_25x57
@@ -239,7 +258,8 @@ const font_t console_fonts[] = {
         .char_width = 25,
         .char_height = 57,
         .font_name = "25x57",
-        .font_bitmap = &console_font_25x57[0]
+        .font_bitmap = &console_font_25x57[0],
+        .glyph_count = 256
     },
 #endif
 };
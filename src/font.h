@@ -49,6 +49,8 @@ typedef struct {
     unsigned char_height;
     const char * font_name;
     unsigned char * font_bitmap;
+    unsigned glyph_count;
+    unsigned baseline;      /* rows above the baseline, 0 if unknown */
 } font_t;
 
 extern const font_t console_fonts[];
@@ -114,6 +116,39 @@ typedef enum {
 #ifdef CONSOLE_USE_FONT_25x57
     FONT_25x57,
 #endif
+    CONSOLE_NUM_FONTS
 } font_id_t;
 
+/*
+ * Binary font files: a 64 byte little endian header followed by the glyph
+ * bitmaps in the same layout as the built-in fonts, rows padded to whole
+ * bytes, glyph_count * char_height rows in total.
+ */
+#define CONSOLE_FONT_MAGIC "CFNT"
+#define CONSOLE_FONT_VERSION 1
+#define CONSOLE_FONT_HEADER_SIZE 64
+#define CONSOLE_FONT_NAME_SIZE 32
+
+/* maps the file read-only, returns NULL on error with errno set */
+font_t * console_font_load(const char * path);
+/* loads a binary font file, a PSF2 font or a BDF font, whichever path holds */
+font_t * console_font_open(const char * path);
+void console_font_free(font_t * font);
+int console_font_save(const font_t * font, const char * path);
+
+/*
+ * Font registry. The built-in fonts are always registered. Registering a
+ * font makes it visible to the lookups under its font_name; release, if
+ * not NULL, is called once the font is unregistered and no console uses
+ * it any more. Lookups return a referenced font, drop it with
+ * console_font_release(). Consoles hold their own reference, so consoles
+ * sharing a font share its bitmap and any caches derived from it.
+ */
+int console_font_register(const font_t * font, void (*release)(font_t * font));
+int console_font_unregister(const char * name);
+const font_t * console_font_lookup(const char * name);
+const font_t * console_font_lookup_size(unsigned char_width, unsigned char_height);
+int console_font_acquire(const font_t * font);
+void console_font_release(const font_t * font);
+
 #endif /* FONT_H_ */
@@ -0,0 +1,85 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+
+static bool console_glyph_pixel(const unsigned char * row, unsigned x) {
+    return row[x >> 3] & (0x80 >> (x & 7));
+}
+
+static unsigned char console_glyph_clamp(unsigned v) {
+    return v > 255 ? 255 : v;
+}
+
+/* last inked row of glyph c, or -1 if it is blank */
+static int console_glyph_last_row(const font_t * font, unsigned c) {
+    unsigned bytes_per_row = (font->char_width + 7) / 8;
+    const unsigned char * glyph = font->font_bitmap + (size_t)c * bytes_per_row * font->char_height;
+    int y;
+    for(y = font->char_height - 1; y >= 0; --y) {
+        unsigned i;
+        for(i = 0; i < bytes_per_row; ++i)
+            if(glyph[y * bytes_per_row + i])
+                return y;
+    }
+    return -1;
+}
+
+static void * console_glyph_info_create(const font_t * font) {
+    struct glyph_info * info = calloc(256, sizeof(struct glyph_info));
+    if(!info)
+        return NULL;
+
+    unsigned w = font->char_width;
+    unsigned h = font->char_height;
+    unsigned bytes_per_row = (w + 7) / 8;
+    /* the bottom of 'H' is a good guess at the baseline for fonts without one */
+    int baseline = font->baseline ? (int)font->baseline - 1 : -1;
+    if(baseline < 0 && font->glyph_count > 'H')
+        baseline = console_glyph_last_row(font, 'H');
+    if(baseline < 0)
+        baseline = h - 1;
+
+    unsigned c;
+    for(c = 0; c < 256; ++c) {
+        unsigned g = c < font->glyph_count ? c : 0;
+        const unsigned char * row = font->font_bitmap + (size_t)g * bytes_per_row * h;
+        unsigned left = w, right = 0, top = h, bottom = 0, ink = 0;
+        unsigned x, y;
+        for(y = 0; y < h; ++y, row += bytes_per_row) {
+            for(x = 0; x < w; ++x) {
+                if(!console_glyph_pixel(row, x))
+                    continue;
+                ++ink;
+                if(x < left)
+                    left = x;
+                if(x + 1 > right)
+                    right = x + 1;
+                if(y < top)
+                    top = y;
+                bottom = y + 1;
+            }
+        }
+
+        struct glyph_info * gi = &info[c];
+        if(ink == 0) {
+            gi->flags = GLYPH_BLANK;
+            gi->left = gi->right = console_glyph_clamp(w);
+            gi->top = gi->bottom = console_glyph_clamp(h);
+            continue;
+        }
+        if(ink == w * h)
+            gi->flags |= GLYPH_SOLID;
+        if((int)bottom - 1 > baseline)
+            gi->flags |= GLYPH_DESCENDER;
+        gi->left = console_glyph_clamp(left);
+        gi->right = console_glyph_clamp(w - right);
+        gi->top = console_glyph_clamp(top);
+        gi->bottom = console_glyph_clamp(h - bottom);
+    }
+    return info;
+}
+
+const struct glyph_info * console_glyph_info(const font_t * font) {
+    return console_font_derived(font, CONSOLE_FONT_SLOT_GLYPH_INFO, console_glyph_info_create, free);
+}
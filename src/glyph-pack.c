@@ -0,0 +1,115 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Packed glyphs drop the per-row byte padding: the rows of a glyph are
+ * concatenated at bit granularity, MSB first, and each glyph starts on a
+ * byte boundary. The table is followed by 8 spare bytes so a row can
+ * always be fetched with one unaligned 64-bit load.
+ */
+
+struct glyph_pack {
+    unsigned glyph_bytes;
+    unsigned char bits[];
+};
+
+size_t console_glyph_packed_bytes(unsigned width, unsigned height) {
+    return ((size_t)width * height + 7) / 8;
+}
+
+/* rows wider than 56 bits don't fit one shifted 64-bit load */
+bool console_glyph_pack_fits(unsigned width, unsigned height) {
+    return width % 8 != 0 && width <= 56 && (width + 7) / 8 * height <= CONSOLE_GLYPH_MAX_BYTES;
+}
+
+static uint64_t console_load_be64(const unsigned char * p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+void console_glyph_pack(unsigned char * dst, const unsigned char * src, unsigned width, unsigned height) {
+    unsigned bytes_per_row = (width + 7) / 8;
+    unsigned bit = 0;
+    unsigned x, y;
+    for(y = 0; y < height; ++y, src += bytes_per_row) {
+        for(x = 0; x < width; ++x, ++bit) {
+            if(src[x >> 3] & (0x80 >> (x & 7)))
+                dst[bit >> 3] |= 0x80 >> (bit & 7);
+        }
+    }
+}
+
+static void * console_glyph_pack_create(const font_t * font) {
+    unsigned w = font->char_width;
+    unsigned h = font->char_height;
+    if(!console_glyph_pack_fits(w, h))
+        return NULL;
+    size_t glyph_bytes = console_glyph_packed_bytes(w, h);
+    struct glyph_pack * pack = calloc(1, sizeof(struct glyph_pack) + glyph_bytes * 256 + 8);
+    if(!pack)
+        return NULL;
+    pack->glyph_bytes = glyph_bytes;
+
+    unsigned c;
+    for(c = 0; c < 256; ++c) {
+        unsigned g = c < font->glyph_count ? c : 0;
+        console_glyph_pack(pack->bits + (size_t)c * glyph_bytes,
+                font->font_bitmap + (size_t)g * ((w + 7) / 8) * h, w, h);
+    }
+    return pack;
+}
+
+void console_glyph_unpack(unsigned char * dst, const unsigned char * src, unsigned width, unsigned height) {
+    unsigned bytes_per_row = (width + 7) / 8;
+    uint64_t mask = ~(uint64_t)0 << (64 - width);
+    unsigned bit = 0;
+    unsigned y;
+    for(y = 0; y < height; ++y, bit += width, dst += bytes_per_row) {
+        uint64_t v = (console_load_be64(src + (bit >> 3)) << (bit & 7)) & mask;
+        switch(bytes_per_row) {
+        case 7: dst[6] = v >> 8;    /* fall through */
+        case 6: dst[5] = v >> 16;   /* fall through */
+        case 5: dst[4] = v >> 24;   /* fall through */
+        case 4: dst[3] = v >> 32;   /* fall through */
+        case 3: dst[2] = v >> 40;   /* fall through */
+        case 2: dst[1] = v >> 48;   /* fall through */
+        case 1: dst[0] = v >> 56;
+        }
+    }
+}
+
+void console_glyph_pack_update(console_t console) {
+    console->glyph_pack = NULL;
+    if(console->packed_glyphs)
+        console->glyph_pack = console_font_derived(console->font, CONSOLE_FONT_SLOT_GLYPH_PACK,
+                console_glyph_pack_create, free);
+}
+
+const unsigned char * console_glyph_bits(console_t console, unsigned char c, unsigned char * scratch) {
+    const struct glyph_pack * pack = console->glyph_pack;
+    if(console->glyph_rotated)
+        return console_glyph_rotated(console, c, scratch);
+    if(!pack)
+        return console_glyph(console, c);
+    console_glyph_unpack(scratch, pack->bits + (size_t)c * pack->glyph_bytes, console->char_width, console->char_height);
+    return scratch;
+}
+
+void console_set_packed_glyphs(console_t console, bool packed) {
+    console->packed_glyphs = packed;
+    console_glyph_pack_update(console);
+    /* rotated glyphs are packed separately */
+    console_glyph_rotate_update(console);
+}
+
+bool console_get_packed_glyphs(console_t console) {
+    return console->packed_glyphs;
+}
@@ -0,0 +1,164 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+
+/*
+ * Rotated copies of a font, one per rotation, built once per font. A glyph
+ * rotated by 90 or 270 degrees is char_height pixels wide and char_width
+ * rows high, rows padded to whole bytes like the upright glyphs. With
+ * packed glyphs the rotated glyphs are packed too, when their rotated
+ * width allows it, and unpacked on use like the upright ones.
+ */
+
+struct glyph_rotated {
+    unsigned bytes_per_char;
+    unsigned width;             /* rotated glyph size, for unpacking */
+    unsigned height;
+    bool packed;
+    unsigned char bits[];
+};
+
+/* rotates one byte padded glyph into the zeroed byte padded dst */
+static void console_glyph_rotate(unsigned char * dst, const unsigned char * src, unsigned gw, unsigned gh,
+        console_rotation rotation) {
+    bool swap = rotation == CONSOLE_ROTATE_90 || rotation == CONSOLE_ROTATE_270;
+    unsigned src_bytes_per_row = (gw + 7) / 8;
+    unsigned dst_bytes_per_row = ((swap ? gh : gw) + 7) / 8;
+    unsigned gx, gy;
+    for(gy = 0; gy < gh; ++gy) {
+        for(gx = 0; gx < gw; ++gx) {
+            if(!(src[gy * src_bytes_per_row + (gx >> 3)] & (0x80 >> (gx & 7))))
+                continue;
+            unsigned px, py;
+            switch(rotation) {
+            case CONSOLE_ROTATE_90:
+                px = gh - 1 - gy;
+                py = gx;
+                break;
+            case CONSOLE_ROTATE_180:
+                px = gw - 1 - gx;
+                py = gh - 1 - gy;
+                break;
+            case CONSOLE_ROTATE_270:
+            default:
+                px = gy;
+                py = gw - 1 - gx;
+                break;
+            }
+            dst[py * dst_bytes_per_row + (px >> 3)] |= 0x80 >> (px & 7);
+        }
+    }
+}
+
+static void * console_glyph_rotate_create(const font_t * font, console_rotation rotation, bool packed) {
+    unsigned gw = font->char_width;
+    unsigned gh = font->char_height;
+    bool swap = rotation == CONSOLE_ROTATE_90 || rotation == CONSOLE_ROTATE_270;
+    unsigned rw = swap ? gh : gw;
+    unsigned rh = swap ? gw : gh;
+    unsigned src_bytes_per_char = (gw + 7) / 8 * gh;
+    unsigned bytes_per_char = (rw + 7) / 8 * rh;
+    packed = packed && console_glyph_pack_fits(rw, rh);
+    if(packed)
+        bytes_per_char = console_glyph_packed_bytes(rw, rh);
+    /* packed glyphs are followed by spare bytes for the 64-bit loads of the unpacking */
+    struct glyph_rotated * rot = calloc(1, sizeof(struct glyph_rotated) + (size_t)bytes_per_char * 256 + 8);
+    if(!rot)
+        return NULL;
+    rot->bytes_per_char = bytes_per_char;
+    rot->width = rw;
+    rot->height = rh;
+    rot->packed = packed;
+
+    unsigned c;
+    for(c = 0; c < 256; ++c) {
+        unsigned g = c < font->glyph_count ? c : 0;
+        const unsigned char * src = font->font_bitmap + (size_t)g * src_bytes_per_char;
+        unsigned char * dst = rot->bits + (size_t)c * bytes_per_char;
+        if(packed) {
+            unsigned char rotated[CONSOLE_GLYPH_MAX_BYTES] = { 0 };
+            console_glyph_rotate(rotated, src, gw, gh, rotation);
+            console_glyph_pack(dst, rotated, rw, rh);
+        } else {
+            console_glyph_rotate(dst, src, gw, gh, rotation);
+        }
+    }
+    return rot;
+}
+
+static void * console_glyph_rotate_create_90(const font_t * font) {
+    return console_glyph_rotate_create(font, CONSOLE_ROTATE_90, false);
+}
+
+static void * console_glyph_rotate_create_180(const font_t * font) {
+    return console_glyph_rotate_create(font, CONSOLE_ROTATE_180, false);
+}
+
+static void * console_glyph_rotate_create_270(const font_t * font) {
+    return console_glyph_rotate_create(font, CONSOLE_ROTATE_270, false);
+}
+
+static void * console_glyph_rotate_create_90_packed(const font_t * font) {
+    return console_glyph_rotate_create(font, CONSOLE_ROTATE_90, true);
+}
+
+static void * console_glyph_rotate_create_180_packed(const font_t * font) {
+    return console_glyph_rotate_create(font, CONSOLE_ROTATE_180, true);
+}
+
+static void * console_glyph_rotate_create_270_packed(const font_t * font) {
+    return console_glyph_rotate_create(font, CONSOLE_ROTATE_270, true);
+}
+
+void console_glyph_rotate_update(console_t console) {
+    bool packed = console->packed_glyphs;
+    switch(console->rotation) {
+    case CONSOLE_ROTATE_90:
+        console->glyph_rotated = packed ?
+                console_font_derived(console->font, CONSOLE_FONT_SLOT_ROTATE_90_PACKED,
+                        console_glyph_rotate_create_90_packed, free) :
+                console_font_derived(console->font, CONSOLE_FONT_SLOT_ROTATE_90,
+                        console_glyph_rotate_create_90, free);
+        break;
+    case CONSOLE_ROTATE_180:
+        console->glyph_rotated = packed ?
+                console_font_derived(console->font, CONSOLE_FONT_SLOT_ROTATE_180_PACKED,
+                        console_glyph_rotate_create_180_packed, free) :
+                console_font_derived(console->font, CONSOLE_FONT_SLOT_ROTATE_180,
+                        console_glyph_rotate_create_180, free);
+        break;
+    case CONSOLE_ROTATE_270:
+        console->glyph_rotated = packed ?
+                console_font_derived(console->font, CONSOLE_FONT_SLOT_ROTATE_270_PACKED,
+                        console_glyph_rotate_create_270_packed, free) :
+                console_font_derived(console->font, CONSOLE_FONT_SLOT_ROTATE_270,
+                        console_glyph_rotate_create_270, free);
+        break;
+    default:
+        console->glyph_rotated = NULL;
+        break;
+    }
+}
+
+const unsigned char * console_glyph_rotated(console_t console, unsigned char c, unsigned char * scratch) {
+    const struct glyph_rotated * rot = console->glyph_rotated;
+    const unsigned char * bits = rot->bits + (size_t)c * rot->bytes_per_char;
+    if(!rot->packed)
+        return bits;
+    console_glyph_unpack(scratch, bits, rot->width, rot->height);
+    return scratch;
+}
+
+void console_set_rotation(console_t console, console_rotation rotation) {
+    if(console->rotation == rotation)
+        return;
+    console->rotation = rotation;
+    console_glyph_rotate_update(console);
+    /* tiles are stored in framebuffer orientation */
+    console_tile_cache_invalidate(console);
+}
+
+console_rotation console_get_rotation(console_t console) {
+    return console->rotation;
+}
@@ -0,0 +1,149 @@
+#include "console.h"
+#include "console-private.h"
+#include "pool.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+/*
+ * A group runs its consoles on a shared work-stealing pool. A console is
+ * in the pool at most once: scheduling sets DIRTY and only submits a task
+ * when SCHEDULED was clear, so whichever worker runs the task owns the
+ * console until it clears SCHEDULED again. Work that arrives while the
+ * task runs sets DIRTY, which makes the task submit itself once more
+ * instead of looping, so one busy console cannot hold a worker.
+ *
+ * Removal sets REMOVED, after which scheduling does nothing and a running
+ * task does not come back, then waits for the console's own batch, which
+ * counts its task, to empty and SCHEDULED to clear.
+ */
+
+#define GROUP_SCHEDULED 1u
+#define GROUP_DIRTY     2u
+#define GROUP_REMOVED   4u
+
+struct console_group {
+    struct pool * pool;
+    console_t * consoles;
+    unsigned count;
+    unsigned capacity;
+};
+
+console_group_t console_group_alloc(unsigned threads) {
+    console_group_t group = calloc(1, sizeof(struct console_group));
+    if(!group)
+        return NULL;
+    group->pool = console_pool_create(threads);
+    if(!group->pool) {
+        free(group);
+        return NULL;
+    }
+    return group;
+}
+
+void console_group_free(console_group_t group) {
+    unsigned i;
+    if(!group)
+        return;
+    console_pool_destroy(group->pool);
+    for(i = 0; i < group->count; ++i)
+        atomic_store_explicit(&group->consoles[i]->group, NULL, memory_order_release);
+    free(group->consoles);
+    free(group);
+}
+
+struct pool * console_group_pool(console_group_t group) {
+    return group->pool;
+}
+
+unsigned console_group_get_threads(console_group_t group) {
+    return console_pool_threads(group->pool);
+}
+
+bool console_group_add(console_group_t group, console_t console, console_group_render_t render, void * data) {
+    console_group_t old = atomic_load_explicit(&console->group, memory_order_relaxed);
+    if(old)
+        console_group_remove(old, console);
+    if(group->count == group->capacity) {
+        unsigned capacity = group->capacity ? group->capacity * 2 : 16;
+        console_t * consoles = realloc(group->consoles, capacity * sizeof(console_t));
+        if(!consoles)
+            return false;
+        group->consoles = consoles;
+        group->capacity = capacity;
+    }
+    group->consoles[group->count++] = console;
+    console->group_render = render;
+    console->group_render_data = data;
+    atomic_store_explicit(&console->group_state, 0, memory_order_relaxed);
+    atomic_store_explicit(&console->group_batch.pending, 0, memory_order_relaxed);
+    atomic_store_explicit(&console->group, group, memory_order_release);
+    return true;
+}
+
+void console_group_remove(console_group_t group, console_t console) {
+    unsigned i;
+    if(atomic_load_explicit(&console->group, memory_order_relaxed) != group)
+        return;
+    atomic_fetch_or_explicit(&console->group_state, GROUP_REMOVED, memory_order_acq_rel);
+    for(;;) {
+        console_pool_wait_batch(group->pool, &console->group_batch);
+        if(!(atomic_load_explicit(&console->group_state, memory_order_acquire) & GROUP_SCHEDULED))
+            break;
+        /* a scheduler set SCHEDULED but has yet to submit */
+        sched_yield();
+    }
+    atomic_store_explicit(&console->group, NULL, memory_order_release);
+    for(i = 0; i < group->count; ++i) {
+        if(group->consoles[i] == console) {
+            group->consoles[i] = group->consoles[--group->count];
+            break;
+        }
+    }
+}
+
+static void console_group_task(void * arg) {
+    console_t console = arg;
+    atomic_fetch_and_explicit(&console->group_state, ~GROUP_DIRTY, memory_order_acquire);
+    console_drain(console, console_queue_pending(console));
+    if(console->group_render)
+        console->group_render(console, console->group_render_data);
+    console_flush(console);
+    /* leave if nothing came in meanwhile or the console is being removed, else go round again */
+    unsigned state = atomic_load_explicit(&console->group_state, memory_order_relaxed);
+    for(;;) {
+        if((state & GROUP_DIRTY) && !(state & GROUP_REMOVED)) {
+            console_group_t group = atomic_load_explicit(&console->group, memory_order_relaxed);
+            console_pool_submit_batch(console_group_pool(group), &console->group_batch,
+                    console_group_task, console);
+            return;
+        }
+        if(atomic_compare_exchange_weak_explicit(&console->group_state, &state,
+                state & GROUP_REMOVED, memory_order_acq_rel, memory_order_relaxed))
+            return;
+    }
+}
+
+void console_schedule(console_t console) {
+    console_group_t group = atomic_load_explicit(&console->group, memory_order_acquire);
+    if(!group)
+        return;
+    unsigned state = atomic_load_explicit(&console->group_state, memory_order_relaxed);
+    do {
+        if(state & GROUP_REMOVED)
+            return;
+    } while(!atomic_compare_exchange_weak_explicit(&console->group_state, &state,
+            state | GROUP_SCHEDULED | GROUP_DIRTY, memory_order_acq_rel, memory_order_relaxed));
+    if(!(state & GROUP_SCHEDULED))
+        console_pool_submit_batch(group->pool, &console->group_batch, console_group_task, console);
+}
+
+void console_group_schedule_all(console_group_t group) {
+    unsigned i;
+    for(i = 0; i < group->count; ++i)
+        console_schedule(group->consoles[i]);
+}
+
+void console_group_wait(console_group_t group) {
+    console_pool_wait(group->pool);
+}
@@ -0,0 +1,261 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+struct pool_task {
+    void (*fn)(void * arg);
+    void * arg;
+    struct pool_batch * batch;
+};
+
+/* ring of tasks, the owner works at the tail and thieves take from the head */
+struct pool_deque {
+    pthread_mutex_t lock;
+    struct pool_task * tasks;
+    unsigned head;
+    unsigned tail;
+    unsigned capacity;      /* power of two */
+};
+
+struct pool {
+    unsigned threads;           /* deques, one per worker */
+    unsigned started;           /* workers running, fewer if thread creation failed */
+    pthread_t * workers;
+    struct pool_deque * deques;
+    _Atomic unsigned queued;    /* tasks sitting in deques */
+    _Atomic unsigned pending;   /* tasks submitted and not finished */
+    _Atomic unsigned next;      /* deque for the next external submit */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    unsigned sleeping;
+    bool stop;
+};
+
+struct pool_worker {
+    struct pool * pool;
+    unsigned index;
+};
+
+static _Thread_local struct pool_worker g_self;
+
+static bool console_pool_push(struct pool_deque * d, struct pool_task task) {
+    pthread_mutex_lock(&d->lock);
+    if(d->tail - d->head == d->capacity) {
+        unsigned capacity = d->capacity ? d->capacity * 2 : 64;
+        struct pool_task * tasks = malloc(capacity * sizeof(struct pool_task));
+        if(!tasks) {
+            pthread_mutex_unlock(&d->lock);
+            return false;
+        }
+        unsigned i;
+        for(i = 0; i < d->tail - d->head; ++i)
+            tasks[i] = d->tasks[(d->head + i) & (d->capacity - 1)];
+        free(d->tasks);
+        d->tasks = tasks;
+        d->tail -= d->head;
+        d->head = 0;
+        d->capacity = capacity;
+    }
+    d->tasks[d->tail++ & (d->capacity - 1)] = task;
+    pthread_mutex_unlock(&d->lock);
+    return true;
+}
+
+static bool console_pool_pop(struct pool_deque * d, struct pool_task * task) {
+    bool found = false;
+    pthread_mutex_lock(&d->lock);
+    if(d->tail != d->head) {
+        *task = d->tasks[--d->tail & (d->capacity - 1)];
+        found = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static bool console_pool_steal(struct pool_deque * d, struct pool_task * task) {
+    bool found = false;
+    pthread_mutex_lock(&d->lock);
+    if(d->tail != d->head) {
+        *task = d->tasks[d->head++ & (d->capacity - 1)];
+        found = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static bool console_pool_take(struct pool * pool, unsigned self, struct pool_task * task) {
+    unsigned i;
+    if(console_pool_pop(&pool->deques[self], task))
+        return true;
+    for(i = 1; i < pool->threads; ++i) {
+        if(console_pool_steal(&pool->deques[(self + i) % pool->threads], task))
+            return true;
+    }
+    return false;
+}
+
+/* waiters for the pool and for batches all sleep on idle */
+static void console_pool_done(struct pool * pool, struct pool_batch * batch) {
+    bool idle = batch && atomic_fetch_sub_explicit(&batch->pending, 1, memory_order_acq_rel) == 1;
+    if(atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_acq_rel) == 1)
+        idle = true;
+    if(idle) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->idle);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void * console_pool_worker(void * arg) {
+    g_self = *(struct pool_worker *)arg;
+    free(arg);
+    struct pool * pool = g_self.pool;
+    unsigned self = g_self.index;
+    struct pool_task task;
+    for(;;) {
+        if(atomic_load_explicit(&pool->queued, memory_order_acquire) &&
+                console_pool_take(pool, self, &task)) {
+            atomic_fetch_sub_explicit(&pool->queued, 1, memory_order_relaxed);
+            task.fn(task.arg);
+            console_pool_done(pool, task.batch);
+            continue;
+        }
+        /* the queued count is rechecked under the lock submitters signal with */
+        pthread_mutex_lock(&pool->lock);
+        if(pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        if(!atomic_load_explicit(&pool->queued, memory_order_acquire)) {
+            ++pool->sleeping;
+            pthread_cond_wait(&pool->wake, &pool->lock);
+            --pool->sleeping;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+struct pool * console_pool_create(unsigned threads) {
+    if(threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (unsigned)n : 1;
+    }
+    struct pool * pool = calloc(1, sizeof(struct pool));
+    if(!pool)
+        return NULL;
+    pool->workers = calloc(threads, sizeof(pthread_t));
+    pool->deques = calloc(threads, sizeof(struct pool_deque));
+    if(!pool->workers || !pool->deques) {
+        free(pool->workers);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    pool->threads = threads;
+    unsigned i;
+    for(i = 0; i < threads; ++i)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    for(i = 0; i < threads; ++i) {
+        struct pool_worker * w = malloc(sizeof(struct pool_worker));
+        if(!w)
+            break;
+        w->pool = pool;
+        w->index = i;
+        if(pthread_create(&pool->workers[i], NULL, console_pool_worker, w) != 0) {
+            free(w);
+            break;
+        }
+        pool->started = i + 1;
+    }
+    /* deques without a worker are emptied by stealing */
+    if(pool->started == 0) {
+        console_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void console_pool_destroy(struct pool * pool) {
+    unsigned i;
+    if(!pool)
+        return;
+    console_pool_wait(pool);
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for(i = 0; i < pool->started; ++i)
+        pthread_join(pool->workers[i], NULL);
+    for(i = 0; i < pool->threads; ++i) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
+
+unsigned console_pool_threads(struct pool * pool) {
+    return pool->started;
+}
+
+void console_pool_submit_batch(struct pool * pool, struct pool_batch * batch, void (*fn)(void * arg), void * arg) {
+    struct pool_task task = { fn, arg, batch };
+    unsigned d = g_self.pool == pool ? g_self.index :
+            atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed) % pool->threads;
+    if(batch)
+        atomic_fetch_add_explicit(&batch->pending, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->pending, 1, memory_order_relaxed);
+    if(!console_pool_push(&pool->deques[d], task)) {
+        /* out of memory, run it here rather than lose it */
+        fn(arg);
+        console_pool_done(pool, batch);
+        return;
+    }
+    atomic_fetch_add_explicit(&pool->queued, 1, memory_order_release);
+    pthread_mutex_lock(&pool->lock);
+    if(pool->sleeping)
+        pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void console_pool_submit(struct pool * pool, void (*fn)(void * arg), void * arg) {
+    console_pool_submit_batch(pool, NULL, fn, arg);
+}
+
+void console_pool_wait(struct pool * pool) {
+    pthread_mutex_lock(&pool->lock);
+    while(atomic_load_explicit(&pool->pending, memory_order_acquire))
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void console_pool_wait_batch(struct pool * pool, struct pool_batch * batch) {
+    bool worker = g_self.pool == pool;
+    struct pool_task task;
+    while(atomic_load_explicit(&batch->pending, memory_order_acquire)) {
+        /* only workers help out, other threads must not run tasks that aren't theirs */
+        if(worker && atomic_load_explicit(&pool->queued, memory_order_acquire) &&
+                console_pool_take(pool, g_self.index, &task)) {
+            atomic_fetch_sub_explicit(&pool->queued, 1, memory_order_relaxed);
+            task.fn(task.arg);
+            console_pool_done(pool, task.batch);
+            continue;
+        }
+        /* whatever is left of the batch is running elsewhere and broadcasts when done */
+        pthread_mutex_lock(&pool->lock);
+        if(atomic_load_explicit(&batch->pending, memory_order_acquire))
+            pthread_cond_wait(&pool->idle, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
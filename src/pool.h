@@ -0,0 +1,35 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+/*
+ * Work-stealing thread pool. Every worker owns a deque: tasks submitted
+ * from a worker go to the bottom of its own deque and it pops from there,
+ * idle workers steal from the top of the others'. Tasks submitted from
+ * other threads are spread over the deques round robin.
+ */
+
+#include <stdatomic.h>
+
+struct pool;
+
+/* counts the unfinished tasks submitted with it, so they can be waited for on their own */
+struct pool_batch {
+    _Atomic unsigned pending;
+};
+
+/* threads 0 starts one worker per online CPU */
+struct pool * console_pool_create(unsigned threads);
+/* waits for the queued tasks before stopping the workers */
+void console_pool_destroy(struct pool * pool);
+unsigned console_pool_threads(struct pool * pool);
+void console_pool_submit(struct pool * pool, void (*fn)(void * arg), void * arg);
+void console_pool_submit_batch(struct pool * pool, struct pool_batch * batch, void (*fn)(void * arg), void * arg);
+/* blocks until every submitted task has finished, must not be called from a worker */
+void console_pool_wait(struct pool * pool);
+/*
+ * blocks until the batch's tasks have finished, a worker runs queued
+ * tasks meanwhile, any other thread only sleeps
+ */
+void console_pool_wait_batch(struct pool * pool, struct pool_batch * batch);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,113 @@
+#include "console.h"
+#include "console-private.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/*
+ * Lock-free single producer, single consumer byte ring. The producer only
+ * writes tail and the consumer only writes head, each on its own cache
+ * line, and both keep a private copy of the other's index so the shared
+ * line is only read when the cached copy says the ring looks full or
+ * empty. Indices run freely and are masked on access.
+ */
+
+#define QUEUE_LINE 64
+
+struct byte_queue {
+    _Alignas(QUEUE_LINE) _Atomic size_t tail;
+    size_t cached_head;
+    _Alignas(QUEUE_LINE) _Atomic size_t head;
+    size_t cached_tail;
+    _Alignas(QUEUE_LINE) size_t mask;
+    unsigned char data[];
+};
+
+void console_queue_free(console_t console) {
+    free(console->queue);
+    console->queue = NULL;
+}
+
+/* not thread safe, set the size before the producer starts */
+void console_set_queue_size(console_t console, size_t bytes) {
+    console_queue_free(console);
+    if(bytes == 0)
+        return;
+    size_t size = 1;
+    while(size < bytes)
+        size <<= 1;
+    size_t alloc = (sizeof(struct byte_queue) + size + QUEUE_LINE - 1) & ~(size_t)(QUEUE_LINE - 1);
+    struct byte_queue * q = aligned_alloc(QUEUE_LINE, alloc);
+    if(!q)
+        return;
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    q->cached_head = 0;
+    q->cached_tail = 0;
+    q->mask = size - 1;
+    console->queue = q;
+}
+
+size_t console_get_queue_size(console_t console) {
+    return console->queue ? console->queue->mask + 1 : 0;
+}
+
+size_t console_enqueue(console_t console, const unsigned char * buf, size_t len) {
+    struct byte_queue * q = console->queue;
+    if(!q || len == 0)
+        return 0;
+    size_t size = q->mask + 1;
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if(size - (tail - q->cached_head) < len)
+        q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+    len = min(len, size - (tail - q->cached_head));
+    if(len == 0)
+        return 0;
+
+    size_t at = tail & q->mask;
+    size_t n = min(len, size - at);
+    memcpy(q->data + at, buf, n);
+    memcpy(q->data, buf + n, len - n);
+    atomic_store_explicit(&q->tail, tail + len, memory_order_release);
+    return len;
+}
+
+size_t console_queue_space(console_t console) {
+    struct byte_queue * q = console->queue;
+    if(!q)
+        return 0;
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+    return q->mask + 1 - (tail - q->cached_head);
+}
+
+size_t console_queue_pending(console_t console) {
+    struct byte_queue * q = console->queue;
+    if(!q)
+        return 0;
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return q->cached_tail - head;
+}
+
+size_t console_drain(console_t console, size_t max) {
+    struct byte_queue * q = console->queue;
+    if(!q)
+        return 0;
+    size_t size = q->mask + 1;
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if(q->cached_tail - head < max)
+        q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    size_t len = min(max, q->cached_tail - head);
+    size_t done = 0;
+    /* at most two runs, the space of each is handed back as soon as it is written */
+    while(done < len) {
+        size_t at = head & q->mask;
+        size_t n = min(len - done, size - at);
+        console_write(console, q->data + at, n);
+        head += n;
+        done += n;
+        atomic_store_explicit(&q->head, head, memory_order_release);
+    }
+    return done;
+}
@@ -0,0 +1,157 @@
+#include "console.h"
+#include "console-private.h"
+#include "pool.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/*
+ * Band-parallel rendering. The framebuffer is cut into horizontal bands
+ * a whole number of cells high, which are console rows, or console columns
+ * when rotated sideways, so no two bands share a framebuffer byte. Each
+ * band gets the bounding rectangle of its damage and only bands with some
+ * are rendered. The caller renders bands too and pool threads join in,
+ * taking the next band from a shared counter. Every thread uses a tile
+ * cache of its own, the first one the console's.
+ */
+
+/* bands per thread, enough to even out bands that are mostly blank */
+#define BAND_SPLIT 4
+
+struct band {
+    unsigned x1;
+    unsigned y1;
+    unsigned x2;
+    unsigned y2;
+};
+
+struct band_job {
+    console_t console;
+    void * pixels;
+    size_t stride;
+    console_pixel_format format;
+    struct band * bands;
+    unsigned count;
+    _Atomic unsigned next;
+    _Atomic unsigned slot;
+};
+
+static void console_band_extend(struct band * band, unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    if(band->x1 >= band->x2) {
+        band->x1 = x1;
+        band->y1 = y1;
+        band->x2 = x2;
+        band->y2 = y2;
+        return;
+    }
+    band->x1 = min(band->x1, x1);
+    band->y1 = min(band->y1, y1);
+    band->x2 = max(band->x2, x2);
+    band->y2 = max(band->y2, y2);
+}
+
+/* adds cells [x1, x2) of row y to the bands they fall in */
+static void console_band_damage(console_t console, struct band * bands, unsigned size,
+        unsigned x1, unsigned y, unsigned x2) {
+    if(!console_rotated_sideways(console)) {
+        console_band_extend(&bands[y / size], x1, y, x2, y + 1);
+        return;
+    }
+    unsigned b;
+    for(b = x1 / size; b * size < x2; ++b)
+        console_band_extend(&bands[b], max(x1, b * size), y, min(x2, (b + 1) * size), y + 1);
+}
+
+static void console_band_cursor(console_t console, struct band * bands, unsigned size, unsigned x, unsigned y) {
+    y += console->view_offset;
+    if(x < console->width && y < console->height)
+        console_band_damage(console, bands, size, x, y, x + 1);
+}
+
+/* what changed since the last flush, everything unless updates are deferred or after a scroll */
+static void console_band_collect(console_t console, struct band * bands, unsigned size) {
+    unsigned w = console->width;
+    unsigned h = console->height;
+    unsigned y;
+    if(!console->deferred || console->pending_scroll > 0) {
+        for(y = 0; y < h; ++y)
+            console_band_damage(console, bands, size, 0, y, w);
+        return;
+    }
+    for(y = 0; y < h; ++y) {
+        const struct span * span = &console->dirty[y];
+        if(span->x1 < span->x2)
+            console_band_damage(console, bands, size, span->x1, y, span->x2);
+    }
+    bool shown = console_cursor_is_shown(console);
+    if(shown == console->flushed_cursor_shown && console->cursor_x == console->flushed_cursor_x &&
+            console->cursor_y == console->flushed_cursor_y)
+        return;
+    if(console->flushed_cursor_shown)
+        console_band_cursor(console, bands, size, console->flushed_cursor_x, console->flushed_cursor_y);
+    if(shown)
+        console_band_cursor(console, bands, size, console->cursor_x, console->cursor_y);
+}
+
+static void console_band_work(void * arg) {
+    struct band_job * job = arg;
+    console_t console = job->console;
+    unsigned slot = atomic_fetch_add_explicit(&job->slot, 1, memory_order_relaxed);
+    struct tile_cache ** cache = slot ? &console->band_caches[slot - 1] : &console->tile_cache;
+    unsigned i;
+    while((i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->count) {
+        const struct band * band = &job->bands[i];
+        console_render_rect_cached(console, cache, job->pixels, job->stride, job->format,
+                band->x1, band->y1, band->x2, band->y2);
+    }
+}
+
+void console_render_bands(console_t console, console_group_t group, void * pixels, size_t stride,
+        console_pixel_format format) {
+    if(format >= CONSOLE_PIXEL_FORMAT_COUNT)
+        return;
+    struct pool * pool = group ? console_group_pool(group) : NULL;
+    unsigned threads = pool ? console_pool_threads(pool) : 0;
+    unsigned cells = console_rotated_sideways(console) ? console->width : console->height;
+    unsigned n = (threads + 1) * BAND_SPLIT;
+    unsigned size = max((cells + n - 1) / n, 1);
+    n = (cells + size - 1) / size;
+    if(n == 0)
+        return;
+
+    struct band * bands = calloc(n, sizeof(struct band));
+    if(!bands) {
+        console_render(console, pixels, stride, format);
+        return;
+    }
+    console_band_collect(console, bands, size);
+    unsigned i, count = 0;
+    for(i = 0; i < n; ++i) {
+        if(bands[i].x1 < bands[i].x2)
+            bands[count++] = bands[i];
+    }
+
+    struct band_job job = {
+        .console = console,
+        .pixels = pixels,
+        .stride = stride,
+        .format = format,
+        .bands = bands,
+        .count = count
+    };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.slot, 0);
+    unsigned helpers = count > 1 ? min(threads, count - 1) : 0;
+    if(!console_band_caches_reserve(console, helpers))
+        helpers = 0;
+    if(helpers > 0) {
+        struct pool_batch batch;
+        atomic_init(&batch.pending, 0);
+        for(i = 0; i < helpers; ++i)
+            console_pool_submit_batch(pool, &batch, console_band_work, &job);
+        console_band_work(&job);
+        console_pool_wait_batch(pool, &batch);
+    } else {
+        console_band_work(&job);
+    }
+    free(bands);
+}
@@ -0,0 +1,176 @@
+#include "console.h"
+#include "console-private.h"
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Packed 1, 2 and 4 bpp targets. Pixels are packed MSB first, the
+ * leftmost pixel in the high bits of a byte, and hold a gray level with
+ * 0 as black. Each palette entry maps to a 16 bit pattern per row phase
+ * that repeats along the row, so threshold and ordered dither output are
+ * both produced by selecting pattern bits with the glyph mask.
+ */
+
+/* enough for a 255 pixel glyph row at 4x scale and 4 bpp, plus the lead byte */
+#define GRAY_ROW_BYTES 520
+
+static const unsigned char g_bayer4[4][4] = {
+    { 0, 8, 2, 10 },
+    { 12, 4, 14, 6 },
+    { 3, 11, 1, 9 },
+    { 15, 7, 13, 5 }
+};
+
+static unsigned console_gray_level(unsigned luma, unsigned levels, console_gray_mode mode,
+        unsigned threshold, unsigned x, unsigned y) {
+    if(mode == CONSOLE_GRAY_THRESHOLD) {
+        if(levels == 2)
+            return luma >= threshold;
+        return (luma * (levels - 1) + 127) / 255;
+    }
+    unsigned scaled = luma * (levels - 1);
+    unsigned base = scaled / 255;
+    unsigned frac = (scaled % 255) * 16 / 255;
+    return base + (frac > g_bayer4[y & 3][x & 3]);
+}
+
+void console_gray_convert(console_t console) {
+    unsigned b, i, y, p;
+    for(b = 0; b < 3; ++b) {
+        unsigned bits = 1u << b;
+        for(i = 0; i < CONSOLE_NUM_PALETTE_ENTRIES; ++i) {
+            const console_rgb_t * rgb = &console->palette[i];
+            unsigned luma = (rgb->r * 299 + rgb->g * 587 + rgb->b * 114 + 500) / 1000;
+            for(y = 0; y < 4; ++y) {
+                uint16_t pattern = 0;
+                for(p = 0; p < 16 / bits; ++p)
+                    pattern = (uint16_t)((pattern << bits) | console_gray_level(luma, 1u << bits,
+                            console->gray_mode, console->gray_threshold, p, y));
+                console->gray_pattern[b][i][y] = pattern;
+            }
+        }
+    }
+}
+
+/* writes one glyph row starting at pixel x of a packed framebuffer row */
+static void console_gray_row(unsigned char * row, unsigned x, const unsigned char * glyph, unsigned width,
+        unsigned scale, unsigned bits, uint16_t fg, uint16_t bg) {
+    unsigned char buf[GRAY_ROW_BYTES];
+    const unsigned char * mask = buf;
+    unsigned bitpos = x * bits;
+    unsigned first = bitpos >> 3;
+    unsigned lead = bitpos & 7;
+    unsigned total = lead + width * scale * bits;
+    unsigned nbytes = (total + 7) / 8;
+    unsigned k;
+
+    if(bits == 1 && scale == 1 && lead == 0) {
+        /* the glyph row already is a 1bpp mask in place */
+        mask = glyph;
+    } else if(bits == 1 && scale == 1) {
+        /* shift it into place */
+        unsigned glyph_bytes = (width + 7) / 8;
+        unsigned char prev = 0;
+        for(k = 0; k < nbytes; ++k) {
+            unsigned char cur = k < glyph_bytes ? glyph[k] : 0;
+            buf[k] = (unsigned char)((prev << (8 - lead)) | (cur >> lead));
+            prev = cur;
+        }
+    } else {
+        unsigned ones = (1u << bits) - 1;
+        unsigned acc = 0, nacc = lead, n = 0, gx, i;
+        for(gx = 0; gx < width; ++gx) {
+            unsigned v = (glyph[gx >> 3] >> (7 - (gx & 7))) & 1 ? ones : 0;
+            for(i = 0; i < scale; ++i) {
+                acc = (acc << bits) | v;
+                nacc += bits;
+                if(nacc >= 8) {
+                    nacc -= 8;
+                    buf[n++] = (unsigned char)(acc >> nacc);
+                }
+            }
+        }
+        if(nacc > 0)
+            buf[n] = (unsigned char)(acc << (8 - nacc));
+    }
+
+    /* patterns are 16 bits long and aligned to even bytes of the row */
+    unsigned char f[2] = { (unsigned char)(fg >> 8), (unsigned char)fg };
+    unsigned char b[2] = { (unsigned char)(bg >> 8), (unsigned char)bg };
+    unsigned char d[2] = { f[0] ^ b[0], f[1] ^ b[1] };
+    unsigned char head = (unsigned char)(0xff >> lead);
+    unsigned char tail = (total & 7) ? (unsigned char)(0xff << (8 - (total & 7))) : 0xff;
+    unsigned char * dst = row + first;
+    unsigned p = first & 1;
+    if(nbytes == 1) {
+        unsigned char edge = head & tail;
+        unsigned char v = b[p] ^ (mask[0] & d[p]);
+        dst[0] = (unsigned char)((dst[0] & ~edge) | (v & edge));
+        return;
+    }
+    unsigned char v = b[p] ^ (mask[0] & d[p]);
+    dst[0] = (unsigned char)((dst[0] & ~head) | (v & head));
+    for(k = 1; k < nbytes - 1; ++k) {
+        p ^= 1;
+        dst[k] = b[p] ^ (mask[k] & d[p]);
+    }
+    p ^= 1;
+    v = b[p] ^ (mask[k] & d[p]);
+    dst[k] = (unsigned char)((dst[k] & ~tail) | (v & tail));
+}
+
+void console_render_gray(console_t console, void * pixels, size_t stride, console_pixel_format format,
+        unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    unsigned bits = console_pixel_bits(format);
+    unsigned b = bits == 1 ? 0 : bits == 2 ? 1 : 2;
+    unsigned scale = console->font_scale;
+    bool sideways = console_rotated_sideways(console);
+    unsigned gw = sideways ? console->char_height : console->char_width;
+    unsigned gh = sideways ? console->char_width : console->char_height;
+    unsigned bytes_per_row = (gw + 7) / 8;
+    const struct glyph_info * info = console->glyph_info;
+    unsigned char scratch[CONSOLE_GLYPH_MAX_BYTES];
+    unsigned char solid[CONSOLE_GLYPH_MAX_BYTES];
+
+    bool cursor = console_cursor_is_shown(console);
+    unsigned cursor_y = console->cursor_y + console->view_offset;
+    unsigned x, y, r, k;
+    for(y = y1; y < y2; ++y) {
+        const struct cell * cell = console_view_row(console, y) + x1;
+        for(x = x1; x < x2; ++x, ++cell) {
+            unsigned char attr = cell->cell.attribute;
+            if(cursor && x == console->cursor_x && y == cursor_y)
+                attr = (unsigned char)((attr << 4) | (attr >> 4));
+            unsigned px, py;
+            console_cell_origin(console, x, y, &px, &py);
+            const unsigned char * glyph;
+            unsigned char flags = info ? info[cell->cell.character].flags : 0;
+            if(flags & (GLYPH_BLANK | GLYPH_SOLID)) {
+                /* one shared row of all ones or all zeros */
+                memset(solid, flags & GLYPH_SOLID ? 0xff : 0, bytes_per_row);
+                glyph = solid;
+            } else {
+                glyph = console_glyph_bits(console, cell->cell.character, scratch);
+            }
+            const uint16_t * fg = console->gray_pattern[b][attr & 0xf];
+            const uint16_t * bg = console->gray_pattern[b][attr >> 4];
+            unsigned char * dst = (unsigned char *)pixels + (size_t)py * stride;
+            for(r = 0; r < gh; ++r) {
+                for(k = 0; k < scale; ++k, ++py, dst += stride)
+                    console_gray_row(dst, px, glyph, gw, scale, bits, fg[py & 3], bg[py & 3]);
+                if(!(flags & (GLYPH_BLANK | GLYPH_SOLID)))
+                    glyph += bytes_per_row;
+            }
+        }
+    }
+}
+
+void console_set_gray_mode(console_t console, console_gray_mode mode, unsigned char threshold) {
+    console->gray_mode = mode;
+    console->gray_threshold = threshold;
+    console_gray_convert(console);
+}
+
+console_gray_mode console_get_gray_mode(console_t console) {
+    return console->gray_mode;
+}
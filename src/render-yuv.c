@@ -0,0 +1,292 @@
+#include "console.h"
+#include "console-private.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Planar 4:2:0 targets. Luma is expanded per cell like the 8 bpp formats.
+ * A chroma sample is the average of its 2x2 pixel block, which within a
+ * cell only depends on how many of the four pixels are foreground, so the
+ * five possible values are mixed once per cell. That needs every block to
+ * lie within one cell, i.e. even cell sizes starting on even pixels. Other
+ * geometries sum the pixels of every cell around the rectangle per block.
+ */
+
+void console_yuv_convert(console_t console) {
+    unsigned i;
+    for(i = 0; i < CONSOLE_NUM_PALETTE_ENTRIES; ++i) {
+        int r = console->palette[i].r;
+        int g = console->palette[i].g;
+        int b = console->palette[i].b;
+        console->yuv_palette[i][0] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        console->yuv_palette[i][1] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        console->yuv_palette[i][2] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+/* U and V of chroma row by start at *u and *v, returns the distance between samples */
+static unsigned console_yuv_chroma_row(const console_yuv_planes_t * planes, console_yuv_format format,
+        unsigned by, unsigned char ** u, unsigned char ** v) {
+    *u = planes->u + (size_t)by * planes->u_stride;
+    if(format == CONSOLE_YUV_NV12) {
+        *v = *u + 1;
+        return 2;
+    }
+    *v = planes->v + (size_t)by * planes->v_stride;
+    return 1;
+}
+
+static inline unsigned console_yuv_bit(const unsigned char * row, unsigned x) {
+    return (row[x >> 3] >> (7 - (x & 7))) & 1;
+}
+
+struct yuv_cell {
+    unsigned px, py;
+    unsigned char c;
+    unsigned char attr;
+    bool solid;                     /* colour of a cell without glyph */
+    const unsigned char * glyph;    /* NULL for blank and solid glyphs */
+};
+
+static void console_yuv_cell(console_t console, unsigned x, unsigned y, bool cursor, unsigned char * scratch,
+        struct yuv_cell * out) {
+    const struct cell * cell = console_view_row(console, y) + x;
+    const struct glyph_info * info = console->glyph_info;
+    unsigned char c = out->c = cell->cell.character;
+    out->attr = cell->cell.attribute;
+    if(cursor && x == console->cursor_x && y == console->cursor_y + console->view_offset)
+        out->attr = (unsigned char)((out->attr << 4) | (out->attr >> 4));
+    console_cell_origin(console, x, y, &out->px, &out->py);
+    out->solid = false;
+    out->glyph = NULL;
+    if(info && (info[c].flags & (GLYPH_BLANK | GLYPH_SOLID)))
+        out->solid = (info[c].flags & GLYPH_SOLID) != 0;
+    else
+        out->glyph = console_glyph_bits(console, c, scratch);
+}
+
+/* chroma of a cell whose blocks all lie inside it */
+static void console_yuv_chroma_cell(console_t console, const console_yuv_planes_t * planes,
+        console_yuv_format format, const struct yuv_cell * cell, unsigned pcw, unsigned pch,
+        unsigned bytes_per_row) {
+    const unsigned char * f = console->yuv_palette[cell->attr & 0xf];
+    const unsigned char * b = console->yuv_palette[cell->attr >> 4];
+    const unsigned char * glyph = cell->glyph;
+    unsigned char mix_u[5], mix_v[5];
+    unsigned n, bx, by, k;
+    for(n = 0; n <= 4; ++n) {
+        mix_u[n] = (unsigned char)((f[1] * n + b[1] * (4 - n) + 2) / 4);
+        mix_v[n] = (unsigned char)((f[2] * n + b[2] * (4 - n) + 2) / 4);
+    }
+    if(f[1] == b[1] && f[2] == b[2])
+        glyph = NULL;
+
+    unsigned scale = console->font_scale;
+    unsigned bw = pcw / 2;
+    for(by = 0; by < pch / 2; ++by) {
+        unsigned char * u, * v;
+        unsigned step = console_yuv_chroma_row(planes, format, cell->py / 2 + by, &u, &v);
+        u += cell->px / 2 * step;
+        v += cell->px / 2 * step;
+        if(!glyph) {
+            n = cell->solid ? 4 : 0;
+            for(bx = 0; bx < bw; ++bx) {
+                u[bx * step] = mix_u[n];
+                v[bx * step] = mix_v[n];
+            }
+        } else if(scale == 1) {
+            /* count both rows' set bits per pixel pair, four pairs per byte */
+            const unsigned char * r0 = glyph + by * 2 * bytes_per_row;
+            const unsigned char * r1 = r0 + bytes_per_row;
+            for(k = 0, bx = 0; bx < bw; ++k) {
+                unsigned s0 = (r0[k] & 0x55) + ((r0[k] >> 1) & 0x55);
+                unsigned s1 = (r1[k] & 0x55) + ((r1[k] >> 1) & 0x55);
+                unsigned shift;
+                for(shift = 6; shift < 8 && bx < bw; shift -= 2, ++bx) {
+                    n = ((s0 >> shift) & 3) + ((s1 >> shift) & 3);
+                    u[bx * step] = mix_u[n];
+                    v[bx * step] = mix_v[n];
+                }
+            }
+        } else {
+            const unsigned char * r0 = glyph + by * 2 / scale * bytes_per_row;
+            const unsigned char * r1 = glyph + (by * 2 + 1) / scale * bytes_per_row;
+            for(bx = 0; bx < bw; ++bx) {
+                unsigned g0 = bx * 2 / scale, g1 = (bx * 2 + 1) / scale;
+                n = console_yuv_bit(r0, g0) + console_yuv_bit(r0, g1) +
+                        console_yuv_bit(r1, g0) + console_yuv_bit(r1, g1);
+                u[bx * step] = mix_u[n];
+                v[bx * step] = mix_v[n];
+            }
+        }
+    }
+}
+
+/* per block sums, U in bits 0-9, V in bits 10-19 and the pixel count above */
+#define YUV_ACC(u, v) ((uint32_t)(u) | (uint32_t)(v) << 10 | (uint32_t)1 << 20)
+
+/*
+ * Chroma of every block touching cells [x1, x2) x [y1, y2) when blocks
+ * straddle cells. Pixels are summed from the rectangle and the ring of
+ * cells around it, margin pixels outside every cell don't count.
+ */
+static void console_yuv_chroma_rect(console_t console, const console_yuv_planes_t * planes,
+        console_yuv_format format, unsigned x1, unsigned y1, unsigned x2, unsigned y2,
+        unsigned pcw, unsigned pch, unsigned bytes_per_row) {
+    unsigned fx1, fy1, fx2, fy2, t;
+    console_cell_origin(console, x1, y1, &fx1, &fy1);
+    console_cell_origin(console, x2 - 1, y2 - 1, &fx2, &fy2);
+    if(fx2 < fx1) {
+        t = fx1;
+        fx1 = fx2;
+        fx2 = t;
+    }
+    if(fy2 < fy1) {
+        t = fy1;
+        fy1 = fy2;
+        fy2 = t;
+    }
+    /* block rows and columns covered, as framebuffer pixels */
+    fx1 &= ~1u;
+    fy1 &= ~1u;
+    fx2 = (fx2 + pcw + 1) & ~1u;
+    fy2 = (fy2 + pch + 1) & ~1u;
+    unsigned bw = (fx2 - fx1) / 2;
+    unsigned bh = (fy2 - fy1) / 2;
+    size_t size = (size_t)bw * bh * sizeof(uint32_t);
+    if(size > console->yuv_acc_size) {
+        uint32_t * acc = realloc(console->yuv_acc, size);
+        if(!acc)
+            return;
+        console->yuv_acc = acc;
+        console->yuv_acc_size = size;
+    }
+    uint32_t * acc = console->yuv_acc;
+    memset(acc, 0, size);
+
+    unsigned scale = console->font_scale;
+    bool cursor = console_cursor_is_shown(console);
+    unsigned char scratch[CONSOLE_GLYPH_MAX_BYTES];
+    unsigned x, y, i, j;
+    for(y = y1 ? y1 - 1 : 0; y < y2 + 1 && y < console->height; ++y) {
+        for(x = x1 ? x1 - 1 : 0; x < x2 + 1 && x < console->width; ++x) {
+            struct yuv_cell cell;
+            console_yuv_cell(console, x, y, cursor, scratch, &cell);
+            /* the part of the cell inside the covered blocks */
+            unsigned i1 = cell.px < fx1 ? fx1 - cell.px : 0;
+            unsigned j1 = cell.py < fy1 ? fy1 - cell.py : 0;
+            unsigned i2 = cell.px + pcw > fx2 ? (cell.px < fx2 ? fx2 - cell.px : 0) : pcw;
+            unsigned j2 = cell.py + pch > fy2 ? (cell.py < fy2 ? fy2 - cell.py : 0) : pch;
+            const unsigned char * f = console->yuv_palette[cell.attr & 0xf];
+            const unsigned char * b = console->yuv_palette[cell.attr >> 4];
+            uint32_t fg = YUV_ACC(f[1], f[2]);
+            uint32_t bg = YUV_ACC(b[1], b[2]);
+            uint32_t delta = fg - bg;
+            for(j = j1; j < j2; ++j) {
+                uint32_t * a = acc + (size_t)((cell.py + j - fy1) / 2) * bw;
+                unsigned fx = cell.px - fx1;
+                if(!cell.glyph) {
+                    uint32_t c = cell.solid ? fg : bg;
+                    for(i = i1; i < i2; ++i)
+                        a[(fx + i) >> 1] += c;
+                    continue;
+                }
+                /* one add per block, a leading and trailing half block on their own */
+                const unsigned char * row = cell.glyph + j / scale * bytes_per_row;
+                i = i1;
+                if(((fx + i) & 1) && i < i2) {
+                    a[(fx + i) >> 1] += bg + delta * console_yuv_bit(row, i / scale);
+                    ++i;
+                }
+                if(scale == 1) {
+                    for(; i + 1 < i2; i += 2)
+                        a[(fx + i) >> 1] += bg * 2 + delta * (console_yuv_bit(row, i) + console_yuv_bit(row, i + 1));
+                } else {
+                    for(; i + 1 < i2; i += 2)
+                        a[(fx + i) >> 1] += bg * 2 + delta *
+                                (console_yuv_bit(row, i / scale) + console_yuv_bit(row, (i + 1) / scale));
+                }
+                if(i < i2)
+                    a[(fx + i) >> 1] += bg + delta * console_yuv_bit(row, i / scale);
+            }
+        }
+    }
+
+    for(j = 0; j < bh; ++j) {
+        unsigned char * u, * v;
+        unsigned step = console_yuv_chroma_row(planes, format, fy1 / 2 + j, &u, &v);
+        const uint32_t * a = acc + (size_t)j * bw;
+        u += fx1 / 2 * step;
+        v += fx1 / 2 * step;
+        for(i = 0; i < bw; ++i) {
+            unsigned n = a[i] >> 20;
+            unsigned su = a[i] & 0x3ff, sv = (a[i] >> 10) & 0x3ff;
+            if(n == 4) {
+                u[i * step] = (unsigned char)((su + 2) >> 2);
+                v[i * step] = (unsigned char)((sv + 2) >> 2);
+            } else if(n) {
+                u[i * step] = (unsigned char)((su + n / 2) / n);
+                v[i * step] = (unsigned char)((sv + n / 2) / n);
+            }
+        }
+    }
+}
+
+void console_render_yuv_rect(console_t console, const console_yuv_planes_t * planes, console_yuv_format format,
+        unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    if(x2 > console->width)
+        x2 = console->width;
+    if(y2 > console->height)
+        y2 = console->height;
+    if(x1 >= x2 || y1 >= y2)
+        return;
+    if(console->rotation != CONSOLE_ROTATE_0 && !console->glyph_rotated)
+        return;
+
+    bool sideways = console_rotated_sideways(console);
+    unsigned gw = sideways ? console->char_height : console->char_width;
+    unsigned bytes_per_row = (gw + 7) / 8;
+    unsigned cw = console->char_width * console->font_scale;
+    unsigned ch = console->char_height * console->font_scale;
+    unsigned pcw = sideways ? ch : cw;
+    unsigned pch = sideways ? cw : ch;
+    bool cursor = console_cursor_is_shown(console);
+    unsigned char scratch[CONSOLE_GLYPH_MAX_BYTES];
+
+    /* cells either all start on even pixels or none do */
+    unsigned px, py;
+    console_cell_origin(console, x1, y1, &px, &py);
+    bool aligned = !((pcw | pch | px | py) & 1);
+
+    unsigned x, y, r;
+    for(y = y1; y < y2; ++y) {
+        for(x = x1; x < x2; ++x) {
+            struct yuv_cell cell;
+            console_yuv_cell(console, x, y, cursor, scratch, &cell);
+            unsigned char fg = console->yuv_palette[cell.attr & 0xf][0];
+            unsigned char bg = console->yuv_palette[cell.attr >> 4][0];
+            unsigned char * dst = planes->y + (size_t)cell.py * planes->y_stride + cell.px;
+            const unsigned char * tile = NULL;
+            if(cell.glyph && console->tile_cache_size > 0)
+                tile = console_tile_cache_lookup(console, &console->tile_cache, cell.c, cell.attr, CONSOLE_PIXEL_Y8, fg, bg);
+            if(tile) {
+                for(r = 0; r < pch; ++r, tile += pcw, dst += planes->y_stride)
+                    memcpy(dst, tile, pcw);
+            } else if(cell.glyph) {
+                console_expand_glyph(console, dst, planes->y_stride, 1, cell.glyph, fg, bg);
+            } else {
+                for(r = 0; r < pch; ++r, dst += planes->y_stride)
+                    memset(dst, cell.solid ? fg : bg, pcw);
+            }
+            if(aligned)
+                console_yuv_chroma_cell(console, planes, format, &cell, pcw, pch, bytes_per_row);
+        }
+    }
+    if(!aligned)
+        console_yuv_chroma_rect(console, planes, format, x1, y1, x2, y2, pcw, pch, bytes_per_row);
+}
+
+void console_render_yuv(console_t console, const console_yuv_planes_t * planes, console_yuv_format format) {
+    console_render_yuv_rect(console, planes, format, 0, 0, console->width, console->height);
+}
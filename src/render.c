@@ -0,0 +1,221 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include "simd.h"
+#include <string.h>
+#include <stdint.h>
+
+static uint32_t console_pixel_from_rgb(console_rgb_t const * rgb, unsigned index, console_pixel_format format) {
+    switch(format) {
+    case CONSOLE_PIXEL_XBGR8888:
+        return 0xff000000 | ((uint32_t)rgb->b << 16) | ((uint32_t)rgb->g << 8) | rgb->r;
+    case CONSOLE_PIXEL_BGRA8888:
+        return ((uint32_t)rgb->b << 24) | ((uint32_t)rgb->g << 16) | ((uint32_t)rgb->r << 8) | 0xff;
+    case CONSOLE_PIXEL_RGB565:
+        return ((uint32_t)(rgb->r >> 3) << 11) | ((uint32_t)(rgb->g >> 2) << 5) | (rgb->b >> 3);
+    case CONSOLE_PIXEL_INDEX8:
+        return index;
+    case CONSOLE_PIXEL_MONO1:
+    case CONSOLE_PIXEL_GRAY2:
+    case CONSOLE_PIXEL_GRAY4:
+        /* packed formats are drawn from gray_pattern, keep the luminance here */
+        return (rgb->r * 299 + rgb->g * 587 + rgb->b * 114 + 500) / 1000;
+    case CONSOLE_PIXEL_XRGB8888:
+    case CONSOLE_PIXEL_ARGB8888:
+    default:
+        return 0xff000000 | ((uint32_t)rgb->r << 16) | ((uint32_t)rgb->g << 8) | rgb->b;
+    }
+}
+
+void console_palette_convert(console_t console) {
+    unsigned f, i;
+    for(f = 0; f < CONSOLE_PIXEL_FORMAT_COUNT; ++f)
+        for(i = 0; i < CONSOLE_NUM_PALETTE_ENTRIES; ++i)
+            console->native_palette[f][i] = console_pixel_from_rgb(&console->palette[i], i, f);
+    console_gray_convert(console);
+    console_yuv_convert(console);
+}
+
+static void console_fill_cell(unsigned char * dst, size_t stride, unsigned bpp, unsigned cw, unsigned ch,
+        uint32_t color) {
+    unsigned r, x;
+    for(r = 0; r < ch; ++r, dst += stride) {
+        switch(bpp) {
+        case 1:
+            memset(dst, (int)color, cw);
+            break;
+        case 2:
+            for(x = 0; x < cw; ++x)
+                ((uint16_t *)dst)[x] = (uint16_t)color;
+            break;
+        default:
+            for(x = 0; x < cw; ++x)
+                ((uint32_t *)dst)[x] = color;
+            break;
+        }
+    }
+}
+
+static void console_expand_glyph_row(void * dst, const unsigned char * src, unsigned width, unsigned scale,
+        unsigned bpp, uint32_t fg, uint32_t bg) {
+    switch(bpp) {
+    case 1:
+        if(scale == 1)
+            console_expand_row_8(dst, src, width, (uint8_t)fg, (uint8_t)bg);
+        else
+            console_expand_row_8_scaled(dst, src, width, scale, (uint8_t)fg, (uint8_t)bg);
+        break;
+    case 2:
+        if(scale == 1)
+            console_expand_row_16(dst, src, width, (uint16_t)fg, (uint16_t)bg);
+        else
+            console_expand_row_16_scaled(dst, src, width, scale, (uint16_t)fg, (uint16_t)bg);
+        break;
+    default:
+        if(scale == 1)
+            console_expand_row_32(dst, src, width, fg, bg);
+        else
+            console_expand_row_32_scaled(dst, src, width, scale, fg, bg);
+        break;
+    }
+}
+
+void console_expand_glyph(console_t console, void * pixels, size_t stride, unsigned bpp,
+        const unsigned char * glyph, uint32_t fg, uint32_t bg) {
+    bool sideways = console_rotated_sideways(console);
+    unsigned gw = sideways ? console->char_height : console->char_width;
+    unsigned gh = sideways ? console->char_width : console->char_height;
+    unsigned scale = console->font_scale;
+    unsigned bytes_per_row = (gw + 7) / 8;
+    unsigned char * dst = pixels;
+    unsigned r, k;
+    if(scale == 1) {
+        for(r = 0; r < gh; ++r, glyph += bytes_per_row, dst += stride)
+            console_expand_glyph_row(dst, glyph, gw, 1, bpp, fg, bg);
+        return;
+    }
+    /* expand each glyph row once, then replicate it down */
+    for(r = 0; r < gh; ++r, glyph += bytes_per_row) {
+        console_expand_glyph_row(dst, glyph, gw, scale, bpp, fg, bg);
+        for(k = 1; k < scale; ++k)
+            memcpy(dst + k * stride, dst, (size_t)gw * scale * bpp);
+        dst += scale * stride;
+    }
+}
+
+void console_render_rect_cached(console_t console, struct tile_cache ** cache, void * pixels, size_t stride,
+        console_pixel_format format, unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    unsigned w = console->width;
+    unsigned cw = console->char_width * console->font_scale;
+    unsigned ch = console->char_height * console->font_scale;
+
+    if(x2 > w)
+        x2 = w;
+    if(y2 > console->height)
+        y2 = console->height;
+    if(x1 >= x2 || y1 >= y2)
+        return;
+    if(console->rotation != CONSOLE_ROTATE_0 && !console->glyph_rotated)
+        return;
+
+    if(format >= CONSOLE_PIXEL_FORMAT_COUNT)
+        return;
+    if(console_pixel_bits(format) < 8) {
+        console_render_gray(console, pixels, stride, format, x1, y1, x2, y2);
+        return;
+    }
+
+    /*
+     * Cells are walked in console order. row is the framebuffer address
+     * of cell (0, y) and x_step moves one cell along the row, so rotated
+     * frames are written in place without a rotation pass.
+     */
+    unsigned view_w = console->view_width;
+    unsigned view_h = console->view_height;
+    unsigned pcw = cw, pch = ch;
+    ptrdiff_t x_step;
+    unsigned char * origin = pixels;
+    size_t px = console_pixel_bytes(format);
+    switch(console->rotation) {
+    case CONSOLE_ROTATE_90:
+        pcw = ch;
+        pch = cw;
+        x_step = (ptrdiff_t)(cw * stride);
+        break;
+    case CONSOLE_ROTATE_180:
+        origin += (view_w - cw) * px;
+        x_step = -(ptrdiff_t)(cw * px);
+        break;
+    case CONSOLE_ROTATE_270:
+        pcw = ch;
+        pch = cw;
+        origin += (size_t)(view_w - cw) * stride;
+        x_step = -(ptrdiff_t)(cw * stride);
+        break;
+    case CONSOLE_ROTATE_0:
+    default:
+        x_step = (ptrdiff_t)(cw * px);
+        break;
+    }
+
+    const struct glyph_info * info = console->glyph_info;
+    unsigned char scratch[CONSOLE_GLYPH_MAX_BYTES];
+    const uint32_t * palette = console->native_palette[format];
+
+    bool cursor = console_cursor_is_shown(console);
+    unsigned cursor_y = console->cursor_y + console->view_offset;
+    unsigned y;
+    for(y = y1; y < y2; ++y) {
+        const struct cell * cell = console_view_row(console, y) + x1;
+        unsigned char * row;
+        switch(console->rotation) {
+        case CONSOLE_ROTATE_90:
+            row = origin + (view_h - (y + 1) * ch) * px;
+            break;
+        case CONSOLE_ROTATE_180:
+            row = origin + (size_t)(view_h - (y + 1) * ch) * stride;
+            break;
+        case CONSOLE_ROTATE_270:
+            row = origin + (size_t)y * ch * px;
+            break;
+        case CONSOLE_ROTATE_0:
+        default:
+            row = origin + (size_t)y * ch * stride;
+            break;
+        }
+        unsigned x;
+        for(x = x1; x < x2; ++x, ++cell) {
+            unsigned char attr = cell->cell.attribute;
+            if(cursor && x == console->cursor_x && y == cursor_y)
+                attr = (unsigned char)((attr << 4) | (attr >> 4));
+            uint32_t fg = palette[attr & 0xf];
+            uint32_t bg = palette[attr >> 4];
+            unsigned char * dst = row + (ptrdiff_t)x * x_step;
+            unsigned r;
+            /* blank and solid glyphs are plain fills, keep them out of the tile cache */
+            if(info && (info[cell->cell.character].flags & (GLYPH_BLANK | GLYPH_SOLID))) {
+                console_fill_cell(dst, stride, px, pcw, pch, info[cell->cell.character].flags & GLYPH_BLANK ? bg : fg);
+                continue;
+            }
+            const unsigned char * tile = NULL;
+            if(console->tile_cache_size > 0)
+                tile = console_tile_cache_lookup(console, cache, cell->cell.character, attr, format, fg, bg);
+            if(tile) {
+                for(r = 0; r < pch; ++r, tile += pcw * px, dst += stride)
+                    memcpy(dst, tile, pcw * px);
+                continue;
+            }
+            const unsigned char * glyph = console_glyph_bits(console, cell->cell.character, scratch);
+            console_expand_glyph(console, dst, stride, px, glyph, fg, bg);
+        }
+    }
+}
+
+void console_render_rect(console_t console, void * pixels, size_t stride, console_pixel_format format,
+        unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    console_render_rect_cached(console, &console->tile_cache, pixels, stride, format, x1, y1, x2, y2);
+}
+
+void console_render(console_t console, void * pixels, size_t stride, console_pixel_format format) {
+    console_render_rect(console, pixels, stride, format, 0, 0, console->width, console->height);
+}
@@ -0,0 +1,94 @@
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include <stddef.h>
+
+/* 32 bit formats are written as native 32 bit words, X and A are 0xff */
+typedef enum {
+    CONSOLE_PIXEL_XRGB8888,    /* 0xXXRRGGBB */
+    CONSOLE_PIXEL_XBGR8888,    /* 0xXXBBGGRR, bytes R G B X on little endian */
+    CONSOLE_PIXEL_ARGB8888,    /* 0xAARRGGBB */
+    CONSOLE_PIXEL_BGRA8888,    /* 0xBBGGRRAA */
+    CONSOLE_PIXEL_RGB565,      /* 16 bit rrrrrggggggbbbbb */
+    CONSOLE_PIXEL_INDEX8,      /* 8 bit palette index, 0-15 */
+    CONSOLE_PIXEL_MONO1,       /* packed gray levels, leftmost pixel in the MSB, 0 is black */
+    CONSOLE_PIXEL_GRAY2,
+    CONSOLE_PIXEL_GRAY4,
+    CONSOLE_PIXEL_FORMAT_COUNT
+} console_pixel_format;
+
+/* planar 4:2:0 layouts, chroma is subsampled 2x2 */
+typedef enum {
+    CONSOLE_YUV_I420,          /* Y plane, U plane, V plane */
+    CONSOLE_YUV_NV12           /* Y plane, one plane of interleaved U V pairs */
+} console_yuv_format;
+
+/* plane pointers and strides in bytes, NV12 uses u for the UV plane and ignores v */
+typedef struct {
+    unsigned char * y;
+    size_t y_stride;
+    unsigned char * u;
+    size_t u_stride;
+    unsigned char * v;
+    size_t v_stride;
+} console_yuv_planes_t;
+
+/* how palette luminance maps onto MONO1, GRAY2 and GRAY4 levels */
+typedef enum {
+    CONSOLE_GRAY_THRESHOLD,    /* MONO1 compares with the threshold, GRAY rounds to the nearest level */
+    CONSOLE_GRAY_DITHER        /* 4x4 ordered dither between the two nearest levels */
+} console_gray_mode;
+
+/* clockwise rotation of the framebuffer relative to the console */
+typedef enum {
+    CONSOLE_ROTATE_0,
+    CONSOLE_ROTATE_90,
+    CONSOLE_ROTATE_180,
+    CONSOLE_ROTATE_270
+} console_rotation;
+
+/*
+ * pixels points at the top left pixel of the framebuffer, stride is in
+ * bytes. When rotated by 90 or 270 degrees the framebuffer is the view
+ * height wide and the view width high.
+ */
+void console_render(console_t console, void * pixels, size_t stride, console_pixel_format format);
+void console_render_rect(console_t console, void * pixels, size_t stride, console_pixel_format format,
+        unsigned x1, unsigned y1, unsigned x2, unsigned y2);
+
+/*
+ * Renders in horizontal bands a whole number of cells high, spread over
+ * the calling thread and the group's threads, or on the calling thread
+ * alone when group is NULL. With deferred updates only bands holding cells
+ * changed since the last console_flush are rendered, so call it before
+ * console_flush; after a scroll, or without deferred updates, the whole
+ * frame is. It may be called from a console's group render function.
+ */
+void console_render_bands(console_t console, console_group_t group, void * pixels, size_t stride,
+        console_pixel_format format);
+
+/*
+ * Renders BT.601 limited range YUV straight into the planes. Chroma
+ * blocks that straddle the rectangle's edge are recomputed from every
+ * cell they cover, so damage rectangles can be rendered one at a time.
+ */
+void console_render_yuv(console_t console, const console_yuv_planes_t * planes, console_yuv_format format);
+void console_render_yuv_rect(console_t console, const console_yuv_planes_t * planes, console_yuv_format format,
+        unsigned x1, unsigned y1, unsigned x2, unsigned y2);
+
+void console_set_gray_mode(console_t console, console_gray_mode mode, unsigned char threshold);
+console_gray_mode console_get_gray_mode(console_t console);
+
+void console_set_rotation(console_t console, console_rotation rotation);
+console_rotation console_get_rotation(console_t console);
+
+/*
+ * bytes of pre-rendered glyph tiles kept per cache, the number of tiles
+ * follows from the glyph size and scale. console_render_bands keeps a
+ * cache per band. 0, or less than one tile, disables the cache.
+ */
+#define CONSOLE_TILE_CACHE_DEFAULT_SIZE (512u * 1024)
+void console_set_tile_cache_size(console_t console, size_t bytes);
+size_t console_get_tile_cache_size(console_t console);
+
+#endif /* RENDER_H_ */
@@ -0,0 +1,85 @@
+#include "console.h"
+#include "console-private.h"
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned console_scrollback_capacity(console_t console) {
+    if(console->scrollback_limit_bytes > 0) {
+        size_t row_bytes = (size_t)console->width * sizeof(struct cell);
+        return row_bytes > 0 ? (unsigned)(console->scrollback_limit_bytes / row_bytes) : 0;
+    }
+    return console->scrollback_limit_rows;
+}
+
+void console_scrollback_free(console_t console) {
+    free(console->scrollback);
+    console->scrollback = NULL;
+    console->scrollback_capacity = 0;
+    console->scrollback_count = 0;
+    console->scrollback_head = 0;
+    console->view_offset = 0;
+}
+
+void console_scrollback_reset(console_t console) {
+    console_scrollback_free(console);
+    unsigned capacity = console_scrollback_capacity(console);
+    if(capacity == 0 || console->width == 0)
+        return;
+    console->scrollback = malloc((size_t)capacity * console->width * sizeof(struct cell));
+    if(console->scrollback)
+        console->scrollback_capacity = capacity;
+}
+
+void console_scrollback_push(console_t console, unsigned n) {
+    unsigned capacity = console->scrollback_capacity;
+    if(capacity == 0)
+        return;
+    unsigned w = console->width;
+    unsigned y = 0;
+    /* only the newest capacity rows can survive */
+    if(n > capacity)
+        y = n - capacity;
+    for(; y < n; ++y) {
+        unsigned slot = console->scrollback_head + console->scrollback_count;
+        if(slot >= capacity)
+            slot -= capacity;
+        memcpy(console->scrollback + (size_t)slot * w, console_row(console, y), w * sizeof(struct cell));
+        if(console->scrollback_count < capacity) {
+            ++console->scrollback_count;
+        } else if(++console->scrollback_head == capacity) {
+            console->scrollback_head = 0;
+        }
+    }
+}
+
+void console_set_scrollback_rows(console_t console, unsigned rows) {
+    console->scrollback_limit_rows = rows;
+    console->scrollback_limit_bytes = 0;
+    console_scrollback_reset(console);
+}
+
+void console_set_scrollback_bytes(console_t console, size_t bytes) {
+    console->scrollback_limit_rows = 0;
+    console->scrollback_limit_bytes = bytes;
+    console_scrollback_reset(console);
+}
+
+unsigned console_get_scrollback_capacity(console_t console) {
+    return console->scrollback_capacity;
+}
+
+unsigned console_get_scrollback_count(console_t console) {
+    return console->scrollback_count;
+}
+
+void console_clear_scrollback(console_t console) {
+    console_set_view_offset(console, 0);
+    console->scrollback_count = 0;
+    console->scrollback_head = 0;
+}
+
+const unsigned short * console_get_scrollback_row(console_t console, unsigned back) {
+    if(back == 0 || back > console->scrollback_count)
+        return NULL;
+    return (const unsigned short *)console_scrollback_row(console, back);
+}
@@ -0,0 +1,480 @@
+#include "simd.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONSOLE_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+static void console_expand_row_32_scalar(uint32_t * dst, const unsigned char * src, unsigned width, uint32_t fg, uint32_t bg) {
+    uint32_t diff = fg ^ bg;
+    unsigned x = 0;
+    for(; x + 8 <= width; x += 8, ++src) {
+        unsigned bits = *src;
+        dst[x + 0] = bg ^ (diff & -(uint32_t)((bits >> 7) & 1));
+        dst[x + 1] = bg ^ (diff & -(uint32_t)((bits >> 6) & 1));
+        dst[x + 2] = bg ^ (diff & -(uint32_t)((bits >> 5) & 1));
+        dst[x + 3] = bg ^ (diff & -(uint32_t)((bits >> 4) & 1));
+        dst[x + 4] = bg ^ (diff & -(uint32_t)((bits >> 3) & 1));
+        dst[x + 5] = bg ^ (diff & -(uint32_t)((bits >> 2) & 1));
+        dst[x + 6] = bg ^ (diff & -(uint32_t)((bits >> 1) & 1));
+        dst[x + 7] = bg ^ (diff & -(uint32_t)(bits & 1));
+    }
+    if(x < width) {
+        unsigned bits = *src;
+        for(; x < width; ++x, bits <<= 1)
+            dst[x] = bg ^ (diff & -(uint32_t)((bits >> 7) & 1));
+    }
+}
+
+static void console_expand_row_16_scalar(uint16_t * dst, const unsigned char * src, unsigned width, uint16_t fg, uint16_t bg) {
+    uint16_t diff = fg ^ bg;
+    unsigned x;
+    for(x = 0; x < width; ++x)
+        dst[x] = bg ^ (diff & -(uint16_t)((src[x >> 3] >> (7 - (x & 7))) & 1));
+}
+
+static void console_expand_row_8_scalar(uint8_t * dst, const unsigned char * src, unsigned width, uint8_t fg, uint8_t bg) {
+    uint8_t diff = fg ^ bg;
+    unsigned x;
+    for(x = 0; x < width; ++x)
+        dst[x] = bg ^ (diff & -(uint8_t)((src[x >> 3] >> (7 - (x & 7))) & 1));
+}
+
+void console_expand_row_16_scaled(uint16_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint16_t fg, uint16_t bg) {
+    uint16_t diff = fg ^ bg;
+    unsigned x, k;
+    for(x = 0; x < width; ++x) {
+        uint16_t v = bg ^ (diff & -(uint16_t)((src[x >> 3] >> (7 - (x & 7))) & 1));
+        for(k = 0; k < scale; ++k)
+            *dst++ = v;
+    }
+}
+
+void console_expand_row_8_scaled(uint8_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint8_t fg, uint8_t bg) {
+    uint8_t diff = fg ^ bg;
+    unsigned x, k;
+    for(x = 0; x < width; ++x) {
+        uint8_t v = bg ^ (diff & -(uint8_t)((src[x >> 3] >> (7 - (x & 7))) & 1));
+        for(k = 0; k < scale; ++k)
+            *dst++ = v;
+    }
+}
+
+static void console_expand_row_32_scaled_scalar(uint32_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint32_t fg, uint32_t bg) {
+    uint32_t diff = fg ^ bg;
+    unsigned x, k;
+    for(x = 0; x < width; ++x) {
+        uint32_t v = bg ^ (diff & -(uint32_t)((src[x >> 3] >> (7 - (x & 7))) & 1));
+        for(k = 0; k < scale; ++k)
+            *dst++ = v;
+    }
+}
+
+#ifdef CONSOLE_SIMD_X86
+
+/* nibble -> four 32-bit lane masks, leftmost pixel in the high bit */
+static const uint32_t g_nibble_mask[16][4] __attribute__((aligned(16))) = {
+    { 0, 0, 0, 0 }, { 0, 0, 0, ~0u }, { 0, 0, ~0u, 0 }, { 0, 0, ~0u, ~0u },
+    { 0, ~0u, 0, 0 }, { 0, ~0u, 0, ~0u }, { 0, ~0u, ~0u, 0 }, { 0, ~0u, ~0u, ~0u },
+    { ~0u, 0, 0, 0 }, { ~0u, 0, 0, ~0u }, { ~0u, 0, ~0u, 0 }, { ~0u, 0, ~0u, ~0u },
+    { ~0u, ~0u, 0, 0 }, { ~0u, ~0u, 0, ~0u }, { ~0u, ~0u, ~0u, 0 }, { ~0u, ~0u, ~0u, ~0u },
+};
+
+__attribute__((target("sse2")))
+static void console_expand_row_32_sse2(uint32_t * dst, const unsigned char * src, unsigned width, uint32_t fg, uint32_t bg) {
+    __m128i vbg = _mm_set1_epi32((int)bg);
+    __m128i vdiff = _mm_set1_epi32((int)(fg ^ bg));
+    unsigned x = 0;
+    for(; x + 8 <= width; x += 8, ++src) {
+        unsigned bits = *src;
+        __m128i hi = _mm_load_si128((const __m128i *)g_nibble_mask[bits >> 4]);
+        __m128i lo = _mm_load_si128((const __m128i *)g_nibble_mask[bits & 0xf]);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(vbg, _mm_and_si128(vdiff, hi)));
+        _mm_storeu_si128((__m128i *)(dst + x + 4), _mm_xor_si128(vbg, _mm_and_si128(vdiff, lo)));
+    }
+    if(x < width) {
+        unsigned bits = *src;
+        if(x + 4 <= width) {
+            __m128i hi = _mm_load_si128((const __m128i *)g_nibble_mask[bits >> 4]);
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(vbg, _mm_and_si128(vdiff, hi)));
+            x += 4;
+            bits <<= 4;
+        }
+        uint32_t diff = fg ^ bg;
+        for(; x < width; ++x, bits <<= 1)
+            dst[x] = bg ^ (diff & -(uint32_t)((bits >> 7) & 1));
+    }
+}
+
+/* one source byte selects eight 16-bit lanes at once */
+__attribute__((target("sse2")))
+static void console_expand_row_16_sse2(uint16_t * dst, const unsigned char * src, unsigned width, uint16_t fg, uint16_t bg) {
+    const __m128i select = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m128i vbg = _mm_set1_epi16((short)bg);
+    __m128i vdiff = _mm_set1_epi16((short)(fg ^ bg));
+    unsigned x = 0;
+    for(; x + 8 <= width; x += 8, ++src) {
+        __m128i bits = _mm_and_si128(_mm_set1_epi16(*src), select);
+        __m128i mask = _mm_cmpeq_epi16(bits, select);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(vbg, _mm_and_si128(vdiff, mask)));
+    }
+    if(x < width)
+        console_expand_row_16_scalar(dst + x, src, width - x, fg, bg);
+}
+
+/* two source bytes fill sixteen 8-bit lanes */
+__attribute__((target("sse2")))
+static void console_expand_row_8_sse2(uint8_t * dst, const unsigned char * src, unsigned width, uint8_t fg, uint8_t bg) {
+    const __m128i select = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m128i vbg = _mm_set1_epi8((char)bg);
+    __m128i vdiff = _mm_set1_epi8((char)(fg ^ bg));
+    unsigned x = 0;
+    for(; x + 16 <= width; x += 16, src += 2) {
+        __m128i bytes = _mm_unpacklo_epi64(_mm_set1_epi8((char)src[0]), _mm_set1_epi8((char)src[1]));
+        __m128i mask = _mm_cmpeq_epi8(_mm_and_si128(bytes, select), select);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(vbg, _mm_and_si128(vdiff, mask)));
+    }
+    if(x < width)
+        console_expand_row_8_scalar(dst + x, src, width - x, fg, bg);
+}
+
+/* 2x and 4x replicate whole nibbles with lane shuffles, other factors go scalar */
+__attribute__((target("sse2")))
+static void console_expand_row_32_scaled_sse2(uint32_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint32_t fg, uint32_t bg) {
+    if(scale != 2 && scale != 4) {
+        console_expand_row_32_scaled_scalar(dst, src, width, scale, fg, bg);
+        return;
+    }
+    __m128i vbg = _mm_set1_epi32((int)bg);
+    __m128i vdiff = _mm_set1_epi32((int)(fg ^ bg));
+    unsigned x = 0;
+    for(; x + 4 <= width; x += 4) {
+        unsigned bits = src[x >> 3];
+        unsigned nibble = (x & 4) ? bits & 0xf : bits >> 4;
+        __m128i v = _mm_xor_si128(vbg, _mm_and_si128(vdiff, _mm_load_si128((const __m128i *)g_nibble_mask[nibble])));
+        if(scale == 2) {
+            _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(v, v));
+            _mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi32(v, v));
+            dst += 8;
+        } else {
+            _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi32(v, 0x00));
+            _mm_storeu_si128((__m128i *)(dst + 4), _mm_shuffle_epi32(v, 0x55));
+            _mm_storeu_si128((__m128i *)(dst + 8), _mm_shuffle_epi32(v, 0xaa));
+            _mm_storeu_si128((__m128i *)(dst + 12), _mm_shuffle_epi32(v, 0xff));
+            dst += 16;
+        }
+    }
+    if(x < width) {
+        /* shift the remaining bits to the front of a byte for the scalar tail */
+        unsigned char rest = (unsigned char)(src[x >> 3] << (x & 7));
+        console_expand_row_32_scaled_scalar(dst, &rest, width - x, scale, fg, bg);
+    }
+}
+
+__attribute__((target("avx2")))
+static void console_expand_row_32_avx2(uint32_t * dst, const unsigned char * src, unsigned width, uint32_t fg, uint32_t bg) {
+    const __m256i select = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m256i vfg = _mm256_set1_epi32((int)fg);
+    __m256i vbg = _mm256_set1_epi32((int)bg);
+    unsigned x = 0;
+    for(; x + 8 <= width; x += 8, ++src) {
+        __m256i bits = _mm256_and_si256(_mm256_set1_epi32(*src), select);
+        __m256i mask = _mm256_cmpeq_epi32(bits, select);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_blendv_epi8(vbg, vfg, mask));
+    }
+    if(x < width) {
+        unsigned n = width - x;
+        __m256i bits = _mm256_and_si256(_mm256_set1_epi32(*src), select);
+        __m256i mask = _mm256_cmpeq_epi32(bits, select);
+        __m256i keep = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        _mm256_maskstore_epi32((int *)(dst + x), keep, _mm256_blendv_epi8(vbg, vfg, mask));
+    }
+}
+
+#endif /* CONSOLE_SIMD_X86 */
+
+static size_t console_scan_printable_scalar(const unsigned char * buf, size_t len) {
+    size_t i;
+    for(i = 0; i < len && buf[i] >= 0x20; ++i)
+        ;
+    return i;
+}
+
+static size_t console_scan_text_scalar(const unsigned char * buf, size_t len) {
+    size_t i;
+    for(i = 0; i < len && buf[i] != '\n' && buf[i] != '\t'; ++i)
+        ;
+    return i;
+}
+
+static void console_store_cells_scalar(void * dst, const unsigned char * src, size_t n, unsigned char attr) {
+    unsigned char * d = dst;
+    for(; n > 0; --n, d += 2) {
+        d[0] = *src++;
+        d[1] = attr;
+    }
+}
+
+static bool console_diff_cells_scalar(const uint16_t * a, const uint16_t * b, size_t n, size_t * first, size_t * last) {
+    size_t i, j;
+    for(i = 0; i < n && a[i] == b[i]; ++i)
+        ;
+    if(i == n)
+        return false;
+    for(j = n - 1; a[j] == b[j]; --j)
+        ;
+    *first = i;
+    *last = j;
+    return true;
+}
+
+#ifdef CONSOLE_SIMD_X86
+
+__attribute__((target("sse2")))
+static size_t console_scan_printable_sse2(const unsigned char * buf, size_t len) {
+    const __m128i space = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        unsigned stop = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, space), v)) & 0xffff;
+        if(stop)
+            return i + __builtin_ctz(stop);
+    }
+    return i + console_scan_printable_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t console_scan_printable_avx2(const unsigned char * buf, size_t len) {
+    const __m256i space = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        unsigned stop = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, space), v));
+        if(stop)
+            return i + __builtin_ctz(stop);
+    }
+    return i + console_scan_printable_scalar(buf + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static size_t console_scan_text_sse2(const unsigned char * buf, size_t len) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        unsigned stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, tab)));
+        if(stop)
+            return i + __builtin_ctz(stop);
+    }
+    return i + console_scan_text_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t console_scan_text_avx2(const unsigned char * buf, size_t len) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        unsigned stop = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, tab)));
+        if(stop)
+            return i + __builtin_ctz(stop);
+    }
+    return i + console_scan_text_scalar(buf + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static void console_store_cells_sse2(void * dst, const unsigned char * src, size_t n, unsigned char attr) {
+    const __m128i a = _mm_set1_epi8((char)attr);
+    unsigned char * d = dst;
+    for(; n >= 16; n -= 16, src += 16, d += 32) {
+        __m128i c = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi8(c, a));
+        _mm_storeu_si128((__m128i *)(d + 16), _mm_unpackhi_epi8(c, a));
+    }
+    console_store_cells_scalar(d, src, n, attr);
+}
+
+/*
+ * The diff kernels compare four vectors per step and only look at them one
+ * by one once the combined mask shows a mismatch. The forward scan finds
+ * the first differing cell, the backward scan then stops at it.
+ */
+__attribute__((target("sse2")))
+static unsigned console_diff_mask_sse2(const uint16_t * a, const uint16_t * b) {
+    __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+    return ~(unsigned)_mm_movemask_epi8(eq) & 0xffff;
+}
+
+__attribute__((target("sse2")))
+static bool console_diff_cells_sse2(const uint16_t * a, const uint16_t * b, size_t n, size_t * first, size_t * last) {
+    size_t i = 0, j = n;
+    unsigned m = 0, k;
+    for(; i + 32 <= n; i += 32) {
+        __m128i e0 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+        __m128i e1 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + i + 8)), _mm_loadu_si128((const __m128i *)(b + i + 8)));
+        __m128i e2 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + i + 16)), _mm_loadu_si128((const __m128i *)(b + i + 16)));
+        __m128i e3 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + i + 24)), _mm_loadu_si128((const __m128i *)(b + i + 24)));
+        if(_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3))) != 0xffff)
+            break;
+    }
+    for(; i + 8 <= n; i += 8) {
+        if((m = console_diff_mask_sse2(a + i, b + i)) != 0)
+            break;
+    }
+    if(m) {
+        i += __builtin_ctz(m) / 2;
+    } else {
+        for(; i < n && a[i] == b[i]; ++i)
+            ;
+        if(i == n)
+            return false;
+    }
+    *first = i;
+
+    /* a differing cell at i bounds the backward scan */
+    for(; j >= i + 32; j -= 32) {
+        __m128i e0 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + j - 32)), _mm_loadu_si128((const __m128i *)(b + j - 32)));
+        __m128i e1 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + j - 24)), _mm_loadu_si128((const __m128i *)(b + j - 24)));
+        __m128i e2 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + j - 16)), _mm_loadu_si128((const __m128i *)(b + j - 16)));
+        __m128i e3 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + j - 8)), _mm_loadu_si128((const __m128i *)(b + j - 8)));
+        if(_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3))) != 0xffff)
+            break;
+    }
+    for(k = 0; j >= i + 8; j -= 8) {
+        if((k = console_diff_mask_sse2(a + j - 8, b + j - 8)) != 0)
+            break;
+    }
+    if(k) {
+        j -= 8 - (31 - __builtin_clz(k)) / 2;
+    } else {
+        for(; a[j - 1] == b[j - 1]; --j)
+            ;
+        --j;
+    }
+    *last = j;
+    return true;
+}
+
+__attribute__((target("avx2")))
+static unsigned console_diff_mask_avx2(const uint16_t * a, const uint16_t * b) {
+    __m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)a), _mm256_loadu_si256((const __m256i *)b));
+    return ~(unsigned)_mm256_movemask_epi8(eq);
+}
+
+__attribute__((target("avx2")))
+static bool console_diff_cells_avx2(const uint16_t * a, const uint16_t * b, size_t n, size_t * first, size_t * last) {
+    size_t i = 0, j = n;
+    unsigned m = 0, k;
+    for(; i + 64 <= n; i += 64) {
+        __m256i e0 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+        __m256i e1 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + i + 16)), _mm256_loadu_si256((const __m256i *)(b + i + 16)));
+        __m256i e2 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + i + 32)), _mm256_loadu_si256((const __m256i *)(b + i + 32)));
+        __m256i e3 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + i + 48)), _mm256_loadu_si256((const __m256i *)(b + i + 48)));
+        if(~(unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(e0, e1), _mm256_and_si256(e2, e3))))
+            break;
+    }
+    for(; i + 16 <= n; i += 16) {
+        if((m = console_diff_mask_avx2(a + i, b + i)) != 0)
+            break;
+    }
+    if(m) {
+        i += __builtin_ctz(m) / 2;
+    } else {
+        for(; i < n && a[i] == b[i]; ++i)
+            ;
+        if(i == n)
+            return false;
+    }
+    *first = i;
+
+    for(; j >= i + 64; j -= 64) {
+        __m256i e0 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + j - 64)), _mm256_loadu_si256((const __m256i *)(b + j - 64)));
+        __m256i e1 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + j - 48)), _mm256_loadu_si256((const __m256i *)(b + j - 48)));
+        __m256i e2 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + j - 32)), _mm256_loadu_si256((const __m256i *)(b + j - 32)));
+        __m256i e3 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(a + j - 16)), _mm256_loadu_si256((const __m256i *)(b + j - 16)));
+        if(~(unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(e0, e1), _mm256_and_si256(e2, e3))))
+            break;
+    }
+    for(k = 0; j >= i + 16; j -= 16) {
+        if((k = console_diff_mask_avx2(a + j - 16, b + j - 16)) != 0)
+            break;
+    }
+    if(k) {
+        j -= 16 - (31 - __builtin_clz(k)) / 2;
+    } else {
+        for(; a[j - 1] == b[j - 1]; --j)
+            ;
+        --j;
+    }
+    *last = j;
+    return true;
+}
+
+#endif /* CONSOLE_SIMD_X86 */
+
+console_expand_row_32_t console_expand_row_32 = console_expand_row_32_scalar;
+console_expand_row_16_t console_expand_row_16 = console_expand_row_16_scalar;
+console_expand_row_8_t console_expand_row_8 = console_expand_row_8_scalar;
+console_expand_row_32_scaled_t console_expand_row_32_scaled = console_expand_row_32_scaled_scalar;
+console_scan_t console_scan_printable = console_scan_printable_scalar;
+console_scan_t console_scan_text = console_scan_text_scalar;
+console_store_cells_t console_store_cells = console_store_cells_scalar;
+console_diff_cells_t console_diff_cells = console_diff_cells_scalar;
+
+#ifdef CONSOLE_SIMD_X86
+
+enum {
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+static int console_simd_level(void) {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SIMD_SSE2;
+    return SIMD_NONE;
+}
+
+/*
+ * Picks the kernels once, before main and so before any thread can call
+ * them; the pointers are never written afterwards. Other targets keep the
+ * scalar kernels.
+ */
+__attribute__((constructor))
+static void console_simd_resolve(void) {
+    switch(console_simd_level()) {
+    case SIMD_AVX2:
+        console_expand_row_32 = console_expand_row_32_avx2;
+        console_scan_printable = console_scan_printable_avx2;
+        console_scan_text = console_scan_text_avx2;
+        console_diff_cells = console_diff_cells_avx2;
+        break;
+    case SIMD_SSE2:
+        console_expand_row_32 = console_expand_row_32_sse2;
+        console_scan_printable = console_scan_printable_sse2;
+        console_scan_text = console_scan_text_sse2;
+        console_diff_cells = console_diff_cells_sse2;
+        break;
+    default:
+        return;
+    }
+    /* these have no AVX2 kernel */
+    console_expand_row_16 = console_expand_row_16_sse2;
+    console_expand_row_8 = console_expand_row_8_sse2;
+    console_expand_row_32_scaled = console_expand_row_32_scaled_sse2;
+    console_store_cells = console_store_cells_sse2;
+}
+
+#endif /* CONSOLE_SIMD_X86 */
@@ -0,0 +1,52 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Expands width pixels of a 1bpp MSB-first glyph row into 32bpp pixels,
+ * selecting fg for set bits and bg for clear bits. Like every pointer
+ * here it is set to the best kernel for the running CPU when the library
+ * is loaded.
+ */
+typedef void (*console_expand_row_32_t)(uint32_t * dst, const unsigned char * src, unsigned width, uint32_t fg, uint32_t bg);
+extern console_expand_row_32_t console_expand_row_32;
+
+/* 16bpp and 8bpp variants of the same expansion. */
+typedef void (*console_expand_row_16_t)(uint16_t * dst, const unsigned char * src, unsigned width, uint16_t fg, uint16_t bg);
+extern console_expand_row_16_t console_expand_row_16;
+typedef void (*console_expand_row_8_t)(uint8_t * dst, const unsigned char * src, unsigned width, uint8_t fg, uint8_t bg);
+extern console_expand_row_8_t console_expand_row_8;
+
+/* As above, writing every pixel scale times for width * scale pixels in total. */
+typedef void (*console_expand_row_32_scaled_t)(uint32_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint32_t fg, uint32_t bg);
+extern console_expand_row_32_scaled_t console_expand_row_32_scaled;
+void console_expand_row_16_scaled(uint16_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint16_t fg, uint16_t bg);
+void console_expand_row_8_scaled(uint8_t * dst, const unsigned char * src, unsigned width,
+        unsigned scale, uint8_t fg, uint8_t bg);
+
+/*
+ * Return the length of the leading run of buf that needs no per-byte
+ * handling: console_scan_printable stops at any C0 control (ANSI mode),
+ * console_scan_text stops at '\n' and '\t' (raw mode).
+ */
+typedef size_t (*console_scan_t)(const unsigned char * buf, size_t len);
+extern console_scan_t console_scan_printable;
+extern console_scan_t console_scan_text;
+
+/* Stores n characters with one attribute as interleaved character/attribute cells. */
+typedef void (*console_store_cells_t)(void * dst, const unsigned char * src, size_t n, unsigned char attr);
+extern console_store_cells_t console_store_cells;
+
+/*
+ * Finds the first and last of n cells that differ between a and b, last
+ * inclusive. Returns false, leaving both alone, when all of them match.
+ */
+typedef bool (*console_diff_cells_t)(const uint16_t * a, const uint16_t * b, size_t n, size_t * first, size_t * last);
+extern console_diff_cells_t console_diff_cells;
+
+#endif /* SIMD_H_ */
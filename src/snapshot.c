@@ -0,0 +1,246 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/*
+ * Snapshots are triple buffered: the writer fills its back slot and swaps
+ * it with the shared one, the reader swaps its front slot with the shared
+ * one when that holds a newer snapshot. Neither side ever waits and each
+ * slot is only touched by whoever owns it. The reader keeps its front slot
+ * while any snapshot it acquired is unreleased, so the slot can't reach
+ * the writer through the shared one.
+ *
+ * Slots keep the grid as a ring like the live buffer, so scrolling only
+ * changes head. Every physical row carries the generation of the snapshot
+ * it was last changed for and a slot only copies the rows newer than the
+ * one it holds.
+ */
+
+#define SNAPSHOT_SLOTS 3
+#define SNAPSHOT_FRESH 4u
+#define SNAPSHOT_LINE 64
+
+struct console_snapshot {
+    uint64_t generation;           /* 0 until first published */
+    unsigned width;
+    unsigned height;
+    unsigned head;
+    struct cell * cells;
+    unsigned view_offset;
+    struct cell * history;         /* view rows above the live screen */
+    unsigned history_rows;
+    unsigned cursor_x;
+    unsigned cursor_y;
+    bool cursor_shown;
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    const font_t * font;
+    unsigned font_scale;
+};
+
+struct snapshot_state {
+    struct console_snapshot slots[SNAPSHOT_SLOTS];
+    _Alignas(SNAPSHOT_LINE) _Atomic unsigned shared;   /* slot index | SNAPSHOT_FRESH */
+    _Alignas(SNAPSHOT_LINE) unsigned back;             /* writer */
+    _Alignas(SNAPSHOT_LINE) unsigned front;            /* reader */
+    unsigned held;                                     /* reader, acquires not released yet */
+};
+
+static void console_snapshot_slot_free(struct console_snapshot * s) {
+    free(s->cells);
+    free(s->history);
+    console_font_release(s->font);
+}
+
+void console_snapshot_free(console_t console) {
+    struct snapshot_state * ss = console->snapshots;
+    unsigned i;
+    if(!ss)
+        return;
+    for(i = 0; i < SNAPSHOT_SLOTS; ++i)
+        console_snapshot_slot_free(&ss->slots[i]);
+    free(ss);
+    console->snapshots = NULL;
+    free(console->row_generation);
+    console->row_generation = NULL;
+}
+
+/* the grid was laid out again, every slot copies everything next time */
+void console_snapshot_resize(console_t console) {
+    if(!console->snapshots)
+        return;
+    uint64_t * rows = realloc(console->row_generation, console->height * sizeof(uint64_t));
+    if(!rows && console->height) {
+        console_snapshot_free(console);
+        return;
+    }
+    console->row_generation = rows;
+    console_snapshot_touch(console, 0, console->height);
+}
+
+void console_snapshot_touch_rows(console_t console, unsigned y1, unsigned y2) {
+    unsigned h = console->height;
+    unsigned r = console->head + y1;
+    if(r >= h)
+        r -= h;
+    for(; y1 < y2; ++y1) {
+        console->row_generation[r] = console->snapshot_generation;
+        if(++r == h)
+            r = 0;
+    }
+}
+
+/* not thread safe, enable before the reader starts and disable after it stopped */
+void console_set_snapshots(console_t console, bool enabled) {
+    if(enabled == (console->snapshots != NULL))
+        return;
+    if(!enabled) {
+        console_snapshot_free(console);
+        return;
+    }
+    struct snapshot_state * ss = aligned_alloc(SNAPSHOT_LINE,
+            (sizeof(struct snapshot_state) + SNAPSHOT_LINE - 1) & ~(size_t)(SNAPSHOT_LINE - 1));
+    if(!ss)
+        return;
+    memset(ss, 0, sizeof(struct snapshot_state));
+    atomic_init(&ss->shared, 0);
+    ss->back = 1;
+    ss->front = 2;
+    console->snapshots = ss;
+    console->snapshot_generation = 1;
+    console_snapshot_resize(console);
+}
+
+bool console_get_snapshots(console_t console) {
+    return console->snapshots != NULL;
+}
+
+static bool console_snapshot_fill(console_t console, struct console_snapshot * s) {
+    unsigned w = console->width;
+    unsigned h = console->height;
+    size_t row_bytes = w * sizeof(struct cell);
+    unsigned r;
+    if(s->width != w || s->height != h) {
+        struct cell * cells = realloc(s->cells, (size_t)w * h * sizeof(struct cell));
+        if(!cells && (size_t)w * h > 0)
+            return false;
+        s->cells = cells;
+        s->width = w;
+        s->height = h;
+        s->generation = 0;
+        s->history_rows = 0;
+    }
+    for(r = 0; r < h; ++r) {
+        if(console->row_generation[r] > s->generation)
+            memcpy(s->cells + (size_t)r * w, console->buffer + (size_t)r * w, row_bytes);
+    }
+    s->head = console->head;
+
+    /* rows shown from the scrollback are copied whole, there are only any while scrolled back */
+    unsigned back = min(console->view_offset, h);
+    if(back > s->history_rows) {
+        struct cell * history = realloc(s->history, back * row_bytes);
+        if(!history)
+            return false;
+        s->history = history;
+        s->history_rows = back;
+    }
+    s->view_offset = back;
+    for(r = 0; r < back; ++r)
+        memcpy(s->history + (size_t)r * w, console_view_row(console, r), row_bytes);
+
+    s->cursor_x = console->cursor_x;
+    s->cursor_y = console->cursor_y;
+    s->cursor_shown = console_cursor_is_shown(console);
+    memcpy(s->palette, console->palette, sizeof(s->palette));
+    if(s->font != console->font) {
+        console_font_acquire(console->font);
+        console_font_release(s->font);
+        s->font = console->font;
+    }
+    s->font_scale = console->font_scale;
+    s->generation = console->snapshot_generation;
+    return true;
+}
+
+void console_snapshot_publish(console_t console) {
+    struct snapshot_state * ss = console->snapshots;
+    if(!ss)
+        return;
+    if(!console_snapshot_fill(console, &ss->slots[ss->back]))
+        return;
+    unsigned old = atomic_exchange_explicit(&ss->shared, ss->back | SNAPSHOT_FRESH, memory_order_acq_rel);
+    ss->back = old & (SNAPSHOT_FRESH - 1);
+    ++console->snapshot_generation;
+}
+
+console_snapshot_t console_snapshot_acquire(console_t console) {
+    struct snapshot_state * ss = console->snapshots;
+    if(!ss)
+        return NULL;
+    /* a held front slot would go to the writer, so nested acquires get the same snapshot */
+    if(!ss->held && (atomic_load_explicit(&ss->shared, memory_order_relaxed) & SNAPSHOT_FRESH)) {
+        unsigned old = atomic_exchange_explicit(&ss->shared, ss->front, memory_order_acq_rel);
+        ss->front = old & (SNAPSHOT_FRESH - 1);
+    }
+    const struct console_snapshot * s = &ss->slots[ss->front];
+    if(!s->generation)
+        return NULL;
+    ++ss->held;
+    return s;
+}
+
+void console_snapshot_release(console_t console, console_snapshot_t snapshot) {
+    struct snapshot_state * ss = console->snapshots;
+    if(ss && snapshot && ss->held)
+        --ss->held;
+}
+
+uint64_t console_snapshot_get_generation(console_snapshot_t snapshot) {
+    return snapshot->generation;
+}
+
+unsigned console_snapshot_get_width(console_snapshot_t snapshot) {
+    return snapshot->width;
+}
+
+unsigned console_snapshot_get_height(console_snapshot_t snapshot) {
+    return snapshot->height;
+}
+
+const unsigned short * console_snapshot_get_row(console_snapshot_t snapshot, unsigned y) {
+    if(y >= snapshot->height)
+        return NULL;
+    if(y < snapshot->view_offset)
+        return (const unsigned short *)(snapshot->history + (size_t)y * snapshot->width);
+    unsigned r = snapshot->head + y - snapshot->view_offset;
+    if(r >= snapshot->height)
+        r -= snapshot->height;
+    return (const unsigned short *)(snapshot->cells + (size_t)r * snapshot->width);
+}
+
+unsigned console_snapshot_get_cursor_x(console_snapshot_t snapshot) {
+    return snapshot->cursor_x;
+}
+
+unsigned console_snapshot_get_cursor_y(console_snapshot_t snapshot) {
+    return snapshot->cursor_y;
+}
+
+bool console_snapshot_cursor_is_shown(console_snapshot_t snapshot) {
+    return snapshot->cursor_shown;
+}
+
+void console_snapshot_get_palette(console_snapshot_t snapshot, console_rgb_t * palette) {
+    memcpy(palette, snapshot->palette, sizeof(snapshot->palette));
+}
+
+const font_t * console_snapshot_get_font(console_snapshot_t snapshot) {
+    return snapshot->font;
+}
+
+unsigned console_snapshot_get_font_scale(console_snapshot_t snapshot) {
+    return snapshot->font_scale;
+}
@@ -0,0 +1,191 @@
+#include "console.h"
+#include "console-private.h"
+#include "font.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#define TILE_NONE (-1)
+
+struct tile {
+    uint32_t key;
+    int hash_next;
+    int lru_prev;
+    int lru_next;
+};
+
+struct tile_cache {
+    unsigned capacity;
+    unsigned count;
+    unsigned tile_pixels;
+    unsigned hash_mask;
+    int lru_head;
+    int lru_tail;
+    int * buckets;
+    struct tile * tiles;
+    uint32_t * pixels;
+};
+
+static unsigned console_tile_hash(struct tile_cache * cache, uint32_t key) {
+    return (key * 2654435761u >> 8) & cache->hash_mask;
+}
+
+static void console_tile_unlink(struct tile_cache * cache, int i) {
+    struct tile * t = &cache->tiles[i];
+    if(t->lru_prev != TILE_NONE)
+        cache->tiles[t->lru_prev].lru_next = t->lru_next;
+    else
+        cache->lru_head = t->lru_next;
+    if(t->lru_next != TILE_NONE)
+        cache->tiles[t->lru_next].lru_prev = t->lru_prev;
+    else
+        cache->lru_tail = t->lru_prev;
+}
+
+static void console_tile_push_front(struct tile_cache * cache, int i) {
+    struct tile * t = &cache->tiles[i];
+    t->lru_prev = TILE_NONE;
+    t->lru_next = cache->lru_head;
+    if(cache->lru_head != TILE_NONE)
+        cache->tiles[cache->lru_head].lru_prev = i;
+    else
+        cache->lru_tail = i;
+    cache->lru_head = i;
+}
+
+static void console_tile_unhash(struct tile_cache * cache, int i) {
+    int * p = &cache->buckets[console_tile_hash(cache, cache->tiles[i].key)];
+    while(*p != i)
+        p = &cache->tiles[*p].hash_next;
+    *p = cache->tiles[i].hash_next;
+}
+
+static void console_tile_cache_destroy(struct tile_cache * cache) {
+    if(cache) {
+        free(cache->buckets);
+        free(cache->tiles);
+        free(cache->pixels);
+        free(cache);
+    }
+}
+
+static unsigned console_tile_pixels(console_t console) {
+    return console->char_width * console->char_height * console->font_scale * console->font_scale;
+}
+
+/* tiles fitting in the byte budget, their bookkeeping and hash buckets included */
+static unsigned console_tile_cache_capacity(console_t console) {
+    size_t tile_bytes = console_tile_pixels(console) * sizeof(uint32_t) + sizeof(struct tile) + 2 * sizeof(int);
+    size_t tiles = console->tile_cache_size / tile_bytes;
+    /* tiles are indexed by int and there are twice as many buckets */
+    return tiles < INT_MAX / 4 ? (unsigned)tiles : INT_MAX / 4;
+}
+
+static struct tile_cache * console_tile_cache_create(console_t console) {
+    struct tile_cache * cache = calloc(1, sizeof(struct tile_cache));
+    if(!cache)
+        return NULL;
+    cache->capacity = console_tile_cache_capacity(console);
+    cache->tile_pixels = console_tile_pixels(console);
+    unsigned buckets = 1;
+    while(buckets < cache->capacity * 2)
+        buckets <<= 1;
+    cache->hash_mask = buckets - 1;
+    cache->lru_head = cache->lru_tail = TILE_NONE;
+    cache->buckets = malloc(buckets * sizeof(int));
+    cache->tiles = malloc(cache->capacity * sizeof(struct tile));
+    cache->pixels = malloc((size_t)cache->capacity * cache->tile_pixels * sizeof(uint32_t));
+    if(!cache->buckets || !cache->tiles || !cache->pixels) {
+        console_tile_cache_destroy(cache);
+        return NULL;
+    }
+    memset(cache->buckets, 0xff, buckets * sizeof(int));
+    return cache;
+}
+
+void console_tile_cache_free(console_t console) {
+    unsigned i;
+    console_tile_cache_destroy(console->tile_cache);
+    console->tile_cache = NULL;
+    for(i = 0; i < console->band_cache_count; ++i) {
+        console_tile_cache_destroy(console->band_caches[i]);
+        console->band_caches[i] = NULL;
+    }
+}
+
+bool console_band_caches_reserve(console_t console, unsigned count) {
+    if(count <= console->band_cache_count)
+        return true;
+    struct tile_cache ** caches = realloc(console->band_caches, count * sizeof(struct tile_cache *));
+    if(!caches)
+        return false;
+    memset(caches + console->band_cache_count, 0, (count - console->band_cache_count) * sizeof(struct tile_cache *));
+    console->band_caches = caches;
+    console->band_cache_count = count;
+    return true;
+}
+
+void console_tile_cache_invalidate(console_t console) {
+    /* tiles depend on the palette and the glyph size, drop them all */
+    console_tile_cache_free(console);
+}
+
+void console_set_tile_cache_size(console_t console, size_t bytes) {
+    if(console->tile_cache_size == bytes)
+        return;
+    console_tile_cache_free(console);
+    console->tile_cache_size = bytes;
+}
+
+size_t console_get_tile_cache_size(console_t console) {
+    return console->tile_cache_size;
+}
+
+const void * console_tile_cache_lookup(console_t console, struct tile_cache ** slot, unsigned char c,
+        unsigned char attr, console_pixel_format format, uint32_t fg, uint32_t bg) {
+    struct tile_cache * cache = *slot;
+    if(!cache) {
+        /* a budget below one tile caches nothing */
+        if(!console_tile_cache_capacity(console))
+            return NULL;
+        cache = *slot = console_tile_cache_create(console);
+        if(!cache)
+            return NULL;
+    }
+
+    uint32_t key = c | ((uint32_t)attr << 8) | ((uint32_t)format << 16) | ((uint32_t)console->font_id << 20);
+    unsigned bucket = console_tile_hash(cache, key);
+    int i;
+    for(i = cache->buckets[bucket]; i != TILE_NONE; i = cache->tiles[i].hash_next) {
+        if(cache->tiles[i].key == key) {
+            if(cache->lru_head != i) {
+                console_tile_unlink(cache, i);
+                console_tile_push_front(cache, i);
+            }
+            return cache->pixels + (size_t)i * cache->tile_pixels;
+        }
+    }
+
+    if(cache->count < cache->capacity) {
+        i = cache->count++;
+    } else {
+        i = cache->lru_tail;
+        console_tile_unlink(cache, i);
+        console_tile_unhash(cache, i);
+    }
+    cache->tiles[i].key = key;
+    cache->tiles[i].hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = i;
+    console_tile_push_front(cache, i);
+
+    unsigned char scratch[CONSOLE_GLYPH_MAX_BYTES];
+    const unsigned char * glyph = console_glyph_bits(console, c, scratch);
+    /* slots are sized for 32 bit pixels, narrower formats use the front of theirs */
+    uint32_t * tile = cache->pixels + (size_t)i * cache->tile_pixels;
+    unsigned tile_width = console_rotated_sideways(console) ? console->char_height : console->char_width;
+    unsigned bpp = console_pixel_bytes(format);
+    console_expand_glyph(console, tile, tile_width * console->font_scale * bpp, bpp, glyph, fg, bg);
+    return tile;
+}
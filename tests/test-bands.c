@@ -0,0 +1,176 @@
+/*
+ * test-bands: console_render_bands keeps a framebuffer equal to a full
+ * console_render, alone or spread over a group's threads, upright and
+ * rotated, from the caller and from a group render function, and with
+ * deferred updates only touches the cells changed since the last flush.
+ */
+#include "console.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 80x30 cells of 8x16 */
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+#define TEST_STEPS 300
+#define TEST_POISON 0x5a
+
+static int g_failures;
+
+static const char * const g_chunks[] = {
+    "hello", "\n", "\r", "abc\ndef\n\n", "\t", "x",
+    "\x1b[5;7H", "\x1b[2J", "\x1b[M", "\x1b[3L", "\x1b[S", "\x1b[T", "\x1b[K", "\x1b[1;31m",
+    "\x1b[0m", "\x1b[10;4r", "\x1b[r", "\x1b[10B", "\x1b[?25l", "\x1b[?25h", "\x1b[44m   "
+};
+
+struct test_target {
+    unsigned char * pixels;
+    unsigned char * full;
+    size_t stride;
+    size_t size;
+    console_pixel_format format;
+    console_group_t group;
+};
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static uint32_t test_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+/* queued instead of written while the console is in a group */
+static void test_write(console_t console, uint32_t * seed, bool queued) {
+    unsigned n = test_random(seed) % 4;
+    while(n-- > 0) {
+        const char * chunk = g_chunks[test_random(seed) % (sizeof(g_chunks) / sizeof(g_chunks[0]))];
+        if(queued)
+            console_enqueue(console, (const unsigned char *)chunk, strlen(chunk));
+        else
+            console_write(console, (const unsigned char *)chunk, strlen(chunk));
+    }
+}
+
+static bool test_matches(console_t console, const struct test_target * t) {
+    console_render(console, t->full, t->stride, t->format);
+    return !memcmp(t->pixels, t->full, t->size);
+}
+
+static void test_render(console_t console, void * data) {
+    struct test_target * t = data;
+    console_render_bands(console, t->group, t->pixels, t->stride, t->format);
+}
+
+/* renders after random writes, flushing like a client would */
+static void test_follow(console_t console, struct test_target * t, console_rotation rotation, const char * what) {
+    uint32_t seed = 0x9e3779b9;
+    unsigned step;
+    console_set_rotation(console, rotation);
+    console_render(console, t->pixels, t->stride, t->format);
+    console_flush(console);
+    for(step = 0; step < TEST_STEPS; ++step) {
+        test_write(console, &seed, false);
+        if(step % 7 == 0)
+            console_blink_cursor(console);
+        console_render_bands(console, t->group, t->pixels, t->stride, t->format);
+        console_flush(console);
+        if(!test_matches(console, t)) {
+            test_check(false, what);
+            return;
+        }
+    }
+}
+
+static void test_target_init(struct test_target * t, console_pixel_format format, console_group_t group) {
+    unsigned bits = format == CONSOLE_PIXEL_MONO1 ? 1 : 32;
+    /* sideways rotation swaps the sides, the stride fits either */
+    t->stride = (TEST_WIDTH * bits + 7) / 8;
+    t->size = t->stride * TEST_WIDTH;
+    t->pixels = malloc(t->size);
+    t->full = malloc(t->size);
+    memset(t->pixels, 0, t->size);
+    memset(t->full, 0, t->size);
+    t->format = format;
+    t->group = group;
+}
+
+static void test_target_free(struct test_target * t) {
+    free(t->pixels);
+    free(t->full);
+}
+
+int main(void) {
+    struct test_target t;
+    unsigned x, y;
+    console_group_t group = console_group_alloc(3);
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    console_set_mode(console, CONSOLE_MODE_ANSI);
+    console_set_deferred_updates(console, true);
+
+    test_target_init(&t, CONSOLE_PIXEL_XRGB8888, NULL);
+    test_follow(console, &t, CONSOLE_ROTATE_0, "bands on the caller differ");
+    t.group = group;
+    test_follow(console, &t, CONSOLE_ROTATE_0, "bands on a group differ");
+    test_follow(console, &t, CONSOLE_ROTATE_90, "rotated bands differ");
+    test_target_free(&t);
+    test_target_init(&t, CONSOLE_PIXEL_MONO1, group);
+    test_follow(console, &t, CONSOLE_ROTATE_0, "MONO1 bands differ");
+    test_follow(console, &t, CONSOLE_ROTATE_270, "rotated MONO1 bands differ");
+    test_target_free(&t);
+
+    /* nothing changed since the flush, nothing drawn; one cell changed, only it drawn */
+    test_target_init(&t, CONSOLE_PIXEL_XRGB8888, group);
+    console_set_rotation(console, CONSOLE_ROTATE_0);
+    console_hide_cursor(console);
+    console_flush(console);
+    size_t frame = t.stride * TEST_HEIGHT;
+    memset(t.pixels, TEST_POISON, frame);
+    console_render_bands(console, group, t.pixels, t.stride, t.format);
+    bool untouched = true;
+    for(x = 0; x < frame && untouched; ++x)
+        untouched = t.pixels[x] == TEST_POISON;
+    test_check(untouched, "bands drawn without damage");
+    console_set_character_and_attribute_at(console, 10, 20, 'Q', 0x1f);
+    console_render_bands(console, group, t.pixels, t.stride, t.format);
+    console_flush(console);
+    for(y = 0; y < TEST_HEIGHT && untouched; ++y) {
+        for(x = 0; x < TEST_WIDTH && untouched; ++x) {
+            bool cell = x / 8 == 10 && y / 16 == 20;
+            const unsigned char * p = t.pixels + y * t.stride + x * 4;
+            bool poison = p[0] == TEST_POISON && p[1] == TEST_POISON && p[2] == TEST_POISON && p[3] == TEST_POISON;
+            untouched = cell != poison;
+        }
+    }
+    test_check(untouched, "bands drew more or less than the damaged cell");
+
+    /* from the group's render function, before its flush */
+    uint32_t seed = 12345;
+    console_render(console, t.pixels, t.stride, t.format);
+    console_set_queue_size(console, 4096);
+    console_group_add(group, console, test_render, &t);
+    for(x = 0; x < 50; ++x) {
+        test_write(console, &seed, true);
+        console_schedule(console);
+        console_group_wait(group);
+    }
+    test_check(test_matches(console, &t), "bands from the render function differ");
+    console_group_remove(group, console);
+    test_target_free(&t);
+
+    console_free(console);
+    console_group_free(group);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/*
+ * test-damage: a client that keeps a framebuffer up to date from the
+ * update callbacks alone must end up with the same pixels as a full
+ * console_render, with and without deferred updates, in raw and ANSI mode.
+ *
+ * The client draws the cursor cell as the events say, which needs the
+ * console's private cursor state.
+ */
+#include "console.h"
+#include "console-private.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 160
+#define TEST_STEPS 2000
+#define TEST_FORMAT CONSOLE_PIXEL_XRGB8888
+
+struct test_client {
+    uint32_t * pixels;
+    size_t stride;
+};
+
+static const char * const g_chunks[] = {
+    "hello", "\n", "\r", "abc\ndef\n\n", "\t", "x",
+    "\x1b[5;7H", "\x1b[2J", "\x1b[M", "\x1b[3L", "\x1b[S", "\x1b[T", "\x1b[K", "\x1b[1;31m",
+    "\x1b[0m", "\x1b[10;4r", "\x1b[r", "\x1b[10B", "\x1b[?25l", "\x1b[?25h", "\x1b[44m   "
+};
+
+static uint32_t test_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void test_paint(console_t console, struct test_client * client, unsigned x1, unsigned y1,
+        unsigned x2, unsigned y2) {
+    console_render_rect(console, client->pixels, client->stride, TEST_FORMAT, x1, y1, x2, y2);
+}
+
+/* one cell, with the cursor drawn on it or not */
+static void test_paint_cell(console_t console, struct test_client * client, unsigned x, unsigned y, bool cursor) {
+    unsigned cursor_x = console->cursor_x;
+    unsigned cursor_y = console->cursor_y;
+    unsigned char cursor_state = console->cursor_state;
+    console->cursor_x = x;
+    console->cursor_y = y;
+    console->cursor_state = cursor ? CURSOR_VISIBLE | CURSOR_SHOWN : 0;
+    test_paint(console, client, x, y, x + 1, y + 1);
+    console->cursor_x = cursor_x;
+    console->cursor_y = cursor_y;
+    console->cursor_state = cursor_state;
+}
+
+/* moves rows up by n and clears the rows exposed at the bottom to the background */
+static void test_scroll(console_t console, struct test_client * client, unsigned n) {
+    size_t row_bytes = client->stride * console->char_height;
+    size_t size = row_bytes * console->height;
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    console_rgb_t bg;
+    uint32_t pixel;
+    size_t i;
+    memmove(client->pixels, (unsigned char *)client->pixels + row_bytes * (console->height - n),
+            row_bytes * n);
+    console_get_palette(console, palette);
+    bg = palette[console_get_background_color(console)];
+    pixel = 0xff000000u | (uint32_t)bg.r << 16 | (uint32_t)bg.g << 8 | bg.b;
+    for(i = row_bytes * n / sizeof(pixel); i < size / sizeof(pixel); ++i)
+        client->pixels[i] = pixel;
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+    struct test_client * client = data;
+    switch(u->type) {
+    case CONSOLE_UPDATE_CHAR:
+        test_paint(console, client, u->data.u_char.x, u->data.u_char.y, u->data.u_char.x + 1, u->data.u_char.y + 1);
+        break;
+    case CONSOLE_UPDATE_ROWS:
+        test_paint(console, client, u->data.u_rows.x1, u->data.u_rows.y1, u->data.u_rows.x2, u->data.u_rows.y2);
+        break;
+    case CONSOLE_UPDATE_SCROLL:
+        test_scroll(console, client, u->data.u_scroll.n);
+        break;
+    case CONSOLE_UPDATE_REFRESH:
+    case CONSOLE_UPDATE_FONT:
+        console_render(console, client->pixels, client->stride, TEST_FORMAT);
+        break;
+    case CONSOLE_UPDATE_CURSOR_VISIBILITY:
+        test_paint_cell(console, client, u->data.u_cursor.x, u->data.u_cursor.y,
+                u->data.u_cursor.cursor_visible && console_cursor_is_shown(console));
+        break;
+    case CONSOLE_UPDATE_CURSOR_POSITION:
+        test_paint_cell(console, client, u->data.u_cursor.x, u->data.u_cursor.y, false);
+        test_paint_cell(console, client, console_get_cursor_x(console), console_get_cursor_y(console),
+                console_cursor_is_shown(console));
+        break;
+    default:
+        break;
+    }
+}
+
+static int test_replay(console_mode mode, bool deferred, const char * name) {
+    size_t size = (size_t)TEST_WIDTH * TEST_HEIGHT * sizeof(uint32_t);
+    struct test_client client = { malloc(size), TEST_WIDTH * sizeof(uint32_t) };
+    uint32_t * reference = malloc(size);
+    uint32_t state = 5;
+    int step, failures = 0;
+
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_8x16);
+    console_set_mode(console, mode);
+    console_set_callback(console, test_callback, &client);
+    /* as if the blink had just turned the cursor on */
+    console->cursor_state |= CURSOR_SHOWN;
+    console_render(console, client.pixels, client.stride, TEST_FORMAT);
+    console_set_deferred_updates(console, deferred);
+
+    for(step = 0; step < TEST_STEPS; ++step) {
+        unsigned char buf[256];
+        size_t len = 0, i;
+        unsigned k = 1 + test_random(&state) % 6;
+        while(k-- > 0) {
+            const char * s = g_chunks[test_random(&state) % (sizeof(g_chunks) / sizeof(g_chunks[0]))];
+            size_t l;
+            if(mode == CONSOLE_MODE_RAW && s[0] == '\x1b')
+                s = "q";
+            l = strlen(s);
+            if(len + l <= sizeof(buf)) {
+                memcpy(buf + len, s, l);
+                len += l;
+            }
+        }
+        if(test_random(&state) % 3 == 0) {
+            console_write(console, buf, len);
+        } else {
+            for(i = 0; i < len; ++i)
+                console_print_char(console, buf[i]);
+        }
+        if(deferred)
+            console_flush(console);
+
+        console_render(console, reference, client.stride, TEST_FORMAT);
+        if(memcmp(reference, client.pixels, size)) {
+            fprintf(stderr, "%s: step %d differs after '", name, step);
+            fwrite(buf, 1, len, stderr);
+            fprintf(stderr, "'\n");
+            /* resynchronise so one bad update is reported once */
+            memcpy(client.pixels, reference, size);
+            if(++failures == 10)
+                break;
+        }
+    }
+
+    console_free(console);
+    free(reference);
+    free(client.pixels);
+    return failures;
+}
+
+int main(void) {
+    int failures = test_replay(CONSOLE_MODE_RAW, false, "raw");
+    failures += test_replay(CONSOLE_MODE_ANSI, false, "ansi");
+    failures += test_replay(CONSOLE_MODE_RAW, true, "raw deferred");
+    failures += test_replay(CONSOLE_MODE_ANSI, true, "ansi deferred");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/*
+ * test-diff: console_diff reports, row by row, the span from the first to
+ * the last cell that changed since the previous call, whether written
+ * through the console or its raw buffer, plus the cells the cursor left
+ * and moved to, also while the view is scrolled back.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 40x10 cells of 8x16 */
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 160
+#define TEST_STEPS 2000
+
+static int g_failures;
+
+static const char * const g_chunks[] = {
+    "hello", "\n", "\r", "abc\ndef\n\n", "\t", "x", "0123456789012345678901234567890123456789"
+};
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static uint32_t test_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static void test_copy_view(console_t console, unsigned short * view) {
+    unsigned w = console_get_width(console), y;
+    for(y = 0; y < console_get_height(console); ++y)
+        memcpy(view + y * w, console_get_view_row(console, y), w * sizeof(unsigned short));
+}
+
+/* spans must run exactly from the first to the last changed cell of each row */
+static bool test_spans_exact(console_t console, const unsigned short * before, const console_span_t * spans,
+        unsigned rows) {
+    unsigned w = console_get_width(console), h = console_get_height(console), x, y, changed = 0;
+    for(y = 0; y < h; ++y) {
+        const unsigned short * now = console_get_view_row(console, y);
+        unsigned x1 = w, x2 = 0;
+        for(x = 0; x < w; ++x) {
+            if(now[x] != before[y * w + x]) {
+                x1 = x1 < x ? x1 : x;
+                x2 = x + 1;
+            }
+        }
+        if(x1 < x2) {
+            ++changed;
+            if(spans[y].x1 != x1 || spans[y].x2 != x2)
+                return false;
+        } else if(spans[y].x1 < spans[y].x2) {
+            return false;
+        }
+    }
+    return changed == rows;
+}
+
+static void test_show_cursor(console_t console) {
+    console_show_cursor(console);
+    while(!console_cursor_is_shown(console))
+        console_blink_cursor(console);
+}
+
+int main(void) {
+    console_span_t spans[64];
+    uint32_t seed = 0x2545f491;
+    unsigned step, y;
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    unsigned w = console_get_width(console), h = console_get_height(console);
+    unsigned short * before = malloc(w * h * sizeof(unsigned short));
+
+    /* the first call reports everything, the next nothing */
+    console_hide_cursor(console);
+    test_check(console_diff(console, spans) == h, "first diff not every row");
+    for(y = 0; y < h; ++y)
+        test_check(spans[y].x1 == 0 && spans[y].x2 == w, "first diff not every cell");
+    test_check(console_diff(console, spans) == 0, "diff without changes");
+
+    /* random writes, through the console and its raw buffer */
+    for(step = 0; step < TEST_STEPS; ++step) {
+        test_copy_view(console, before);
+        unsigned n = test_random(&seed) % 4;
+        while(n-- > 0) {
+            uint32_t r = test_random(&seed);
+            if(r & 1) {
+                const char * chunk = g_chunks[(r >> 1) % (sizeof(g_chunks) / sizeof(g_chunks[0]))];
+                console_write(console, (const unsigned char *)chunk, strlen(chunk));
+            } else if(r & 2) {
+                console_set_character_and_attribute_at(console, (r >> 8) % w, (r >> 16) % h,
+                        (unsigned char)(r >> 24), (unsigned char)r);
+            } else {
+                console_linearize(console);
+                console_get_raw_buffer(console)[(r >> 8) % (w * h)] ^= (unsigned short)(r >> 16);
+            }
+        }
+        unsigned rows = console_diff(console, spans);
+        if(!test_spans_exact(console, before, spans, rows)) {
+            test_check(false, "random changes not reported exactly");
+            break;
+        }
+    }
+
+    /* palette changes leave the cells alone */
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    console_get_palette(console, palette);
+    palette[0].r ^= 1;
+    console_set_palette(console, palette);
+    test_check(console_diff(console, spans) == 0, "palette change reported");
+
+    /* the cursor's old and new cells */
+    console_cursor_goto_xy(console, 3, 2);
+    test_show_cursor(console);
+    console_diff(console, spans);
+    console_cursor_goto_xy(console, 7, 5);
+    test_check(console_diff(console, spans) == 2, "cursor move not two rows");
+    test_check(spans[2].x1 == 3 && spans[2].x2 == 4 && spans[5].x1 == 7 && spans[5].x2 == 8,
+            "cursor move spans");
+    console_hide_cursor(console);
+    test_check(console_diff(console, spans) == 1 && spans[5].x1 == 7 && spans[5].x2 == 8, "hidden cursor");
+
+    /* scrolled back, the cursor is drawn view_offset rows lower */
+    console_set_scrollback_rows(console, 100);
+    for(y = 0; y < 3 * h; ++y)
+        console_write(console, (const unsigned char *)"line\n", 5);
+    /* a column blank in every row, only the cursor changes it */
+    unsigned cy = console_get_cursor_y(console);
+    console_cursor_goto_xy(console, 20, cy);
+    test_show_cursor(console);
+    console_diff(console, spans);
+    console_set_view_offset(console, 3);
+    console_diff(console, spans);
+    test_check(spans[cy].x2 == 21, "cell the cursor left while scrolling back");
+
+    /* a font change reports everything again */
+    console_set_font(console, FONT_10x20);
+    unsigned rows = console_diff(console, spans);
+    test_check(rows == console_get_height(console) && spans[0].x1 == 0 && spans[0].x2 == console_get_width(console),
+            "font change not every cell");
+
+    free(before);
+    console_free(console);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/*
+ * test-font-file: a built-in font saved with console_font_save loads back
+ * with the same glyphs, and console_font_load rejects headers whose sizes
+ * the renderers can't handle or whose bitmap the file doesn't hold.
+ */
+#include "console.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_put32(unsigned char * p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/* writes a header followed by bitmap_bytes bytes of bitmap */
+static void test_write_font(const char * path, uint32_t width, uint32_t height, uint32_t count,
+        uint32_t stride, size_t bitmap_bytes) {
+    unsigned char h[CONSOLE_FONT_HEADER_SIZE];
+    memset(h, 0, sizeof(h));
+    memcpy(h, CONSOLE_FONT_MAGIC, 4);
+    h[4] = CONSOLE_FONT_VERSION;
+    h[6] = CONSOLE_FONT_HEADER_SIZE;
+    test_put32(h + 8, width);
+    test_put32(h + 12, height);
+    test_put32(h + 16, count);
+    test_put32(h + 20, stride);
+    test_put32(h + 24, CONSOLE_FONT_HEADER_SIZE);
+    strcpy((char *)h + 28, "test");
+    FILE * f = fopen(path, "wb");
+    fwrite(h, sizeof(h), 1, f);
+    while(bitmap_bytes-- > 0)
+        fputc(0x5a, f);
+    fclose(f);
+}
+
+static bool test_rejected(const char * path) {
+    errno = 0;
+    font_t * font = console_font_load(path);
+    if(font) {
+        console_font_free(font);
+        return false;
+    }
+    return errno == EINVAL;
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+int main(void) {
+    char path[] = "/tmp/console-test-font-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    /* round trip */
+    const font_t * builtin = &console_fonts[FONT_10x20];
+    size_t bytes = (size_t)builtin->glyph_count * builtin->char_height * ((builtin->char_width + 7) / 8);
+    test_check(console_font_save(builtin, path) == 0, "save failed");
+    font_t * font = console_font_load(path);
+    test_check(font != NULL, "saved font does not load");
+    if(font) {
+        test_check(font->char_width == builtin->char_width && font->char_height == builtin->char_height &&
+                font->glyph_count == builtin->glyph_count, "loaded font has the wrong size");
+        test_check(!memcmp(font->font_bitmap, builtin->font_bitmap, bytes), "loaded glyphs differ");
+        test_check(!strcmp(font->font_name, builtin->font_name), "loaded font has the wrong name");
+        console_font_free(font);
+    }
+
+    /* the largest glyphs allowed render at the largest scale in every format */
+    test_write_font(path, 255, 255, 2, 32, 2 * 255 * 32);
+    font = console_font_load(path);
+    test_check(font != NULL, "255x255 font does not load");
+    if(font) {
+        unsigned w = 255 * CONSOLE_MAX_FONT_SCALE, h = 255 * CONSOLE_MAX_FONT_SCALE;
+        console_t console = console_alloc(w, h, FONT_8x16);
+        console_set_callback(console, test_callback, NULL);
+        console_set_font_data(console, font);
+        console_set_font_scale(console, CONSOLE_MAX_FONT_SCALE);
+        console_print_char(console, 1);
+        void * pixels = malloc((size_t)w * 4 * h);
+        int format;
+        for(format = 0; format < CONSOLE_PIXEL_FORMAT_COUNT; ++format)
+            console_render(console, pixels, (size_t)w * 4, (console_pixel_format)format);
+        free(pixels);
+        console_free(console);
+        console_font_free(font);
+    }
+
+    test_write_font(path, 256, 16, 1, 32, 16 * 32);
+    test_check(test_rejected(path), "256 pixel wide glyphs accepted");
+    test_write_font(path, 300, 16, 1, 38, 16 * 38);
+    test_check(test_rejected(path), "300 pixel wide glyphs accepted");
+    test_write_font(path, 8, 256, 1, 1, 256);
+    test_check(test_rejected(path), "256 pixel high glyphs accepted");
+    test_write_font(path, 8, 16, 1, 2, 32);
+    test_check(test_rejected(path), "stride not matching the width accepted");
+    test_write_font(path, 8, 16, 2, 1, 31);
+    test_check(test_rejected(path), "truncated bitmap accepted");
+    /* count * height * stride wraps a 32-bit size_t to 0 */
+    test_write_font(path, 255, 128, 0x100000, 32, 0);
+    test_check(test_rejected(path), "bitmap size overflow accepted");
+    test_write_font(path, 255, 255, 0xffffffffu, 32, 16);
+    test_check(test_rejected(path), "huge glyph count accepted");
+    test_write_font(path, 0, 16, 1, 0, 16);
+    test_check(test_rejected(path), "zero width accepted");
+
+    unlink(path);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/*
+ * test-font-import: console_font_open reads PSF2 fonts with the same glyph
+ * layout as ours, places BDF glyphs by their bounding boxes, keeps at most
+ * 256 glyphs and rejects sizes the renderers can't handle.
+ */
+#include "console.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_put32(unsigned char * p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/* count glyphs cycling through the font's, header padded to header_size */
+static void test_write_psf2(const char * path, const font_t * font, uint32_t width, uint32_t count,
+        uint32_t header_size) {
+    unsigned char h[64];
+    uint32_t charsize = (font->char_width + 7) / 8 * font->char_height;
+    uint32_t i;
+    memset(h, 0, sizeof(h));
+    memcpy(h, "\x72\xb5\x4a\x86", 4);
+    test_put32(h + 8, header_size);
+    test_put32(h + 16, count);
+    test_put32(h + 20, charsize);
+    test_put32(h + 24, font->char_height);
+    test_put32(h + 28, width);
+    FILE * f = fopen(path, "wb");
+    fwrite(h, header_size, 1, f);
+    for(i = 0; i < count; ++i)
+        fwrite(font->font_bitmap + (size_t)(i % font->glyph_count) * charsize, charsize, 1, f);
+    fclose(f);
+}
+
+static void test_write_text(const char * path, const char * text) {
+    FILE * f = fopen(path, "wb");
+    fputs(text, f);
+    fclose(f);
+}
+
+static bool test_rejected(const char * path) {
+    errno = 0;
+    font_t * font = console_font_open(path);
+    if(font) {
+        console_font_free(font);
+        return false;
+    }
+    return errno == EINVAL;
+}
+
+/* an 8x8 cell with the baseline 6 rows down, a full glyph and a 2x2 one placed inside */
+static const char g_bdf[] =
+    "STARTFONT 2.1\n"
+    "FONT -test-test-medium-r-normal--8-80-75-75-c-80-iso8859-1\n"
+    "SIZE 8 75 75\n"
+    "FONTBOUNDINGBOX 8 8 0 -2\n"
+    "STARTPROPERTIES 1\n"
+    "FAMILY_NAME \"Test\"\n"
+    "ENDPROPERTIES\n"
+    "CHARS 3\n"
+    "STARTCHAR A\n"
+    "ENCODING 65\n"
+    "BBX 8 8 0 -2\n"
+    "BITMAP\n"
+    "18\n24\n42\n7E\n42\n42\n00\nFF\n"
+    "ENDCHAR\n"
+    "STARTCHAR dot\n"
+    "ENCODING 46\n"
+    "BBX 2 2 3 0\n"
+    "BITMAP\n"
+    "C0\nC0\n"
+    "ENDCHAR\n"
+    "STARTCHAR unreachable\n"
+    "ENCODING 300\n"
+    "BBX 8 8 0 -2\n"
+    "BITMAP\n"
+    "FF\nFF\nFF\nFF\nFF\nFF\nFF\nFF\n"
+    "ENDCHAR\n"
+    "ENDFONT\n";
+
+int main(void) {
+    char path[] = "/tmp/console-test-import-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    /* PSF2, glyphs past 256 are dropped */
+    const font_t * builtin = &console_fonts[FONT_10x20];
+    size_t charsize = (builtin->char_width + 7) / 8 * builtin->char_height;
+    test_write_psf2(path, builtin, builtin->char_width, 300, 32);
+    font_t * font = console_font_open(path);
+    test_check(font != NULL, "PSF2 font does not load");
+    if(font) {
+        test_check(font->char_width == builtin->char_width && font->char_height == builtin->char_height,
+                "PSF2 font has the wrong size");
+        test_check(font->glyph_count == 256, "PSF2 glyphs not limited to 256");
+        unsigned glyphs = builtin->glyph_count < 256 ? builtin->glyph_count : 256;
+        test_check(!memcmp(font->font_bitmap, builtin->font_bitmap, glyphs * charsize), "PSF2 glyphs differ");
+        console_font_free(font);
+    }
+    /* a longer header is skipped */
+    test_write_psf2(path, builtin, builtin->char_width, 16, 64);
+    font = console_font_open(path);
+    test_check(font && !memcmp(font->font_bitmap, builtin->font_bitmap, 16 * charsize),
+            "PSF2 header size not honoured");
+    console_font_free(font);
+    test_write_psf2(path, builtin, 256, 16, 32);
+    test_check(test_rejected(path), "PSF2 256 pixel wide glyphs accepted");
+    test_write_psf2(path, builtin, builtin->char_width + 8, 16, 32);
+    test_check(test_rejected(path), "PSF2 charsize not matching the width accepted");
+
+    /* BDF */
+    test_write_text(path, g_bdf);
+    font = console_font_open(path);
+    test_check(font != NULL, "BDF font does not load");
+    if(font) {
+        static const unsigned char a[8] = { 0x18, 0x24, 0x42, 0x7e, 0x42, 0x42, 0x00, 0xff };
+        static const unsigned char dot[8] = { 0, 0, 0, 0, 0x18, 0x18, 0, 0 };
+        test_check(font->char_width == 8 && font->char_height == 8, "BDF font has the wrong size");
+        test_check(font->baseline == 6, "BDF baseline");
+        test_check(!strcmp(font->font_name, "Test (8x8)"), "BDF family name");
+        test_check(!memcmp(font->font_bitmap + 'A' * 8, a, 8), "BDF glyph wrong");
+        test_check(!memcmp(font->font_bitmap + '.' * 8, dot, 8), "BDF glyph not placed by its bounding box");
+        console_font_free(font);
+    }
+    test_write_text(path, "STARTFONT 2.1\nFONTBOUNDINGBOX 256 8 0 0\nCHARS 0\nENDFONT\n");
+    test_check(test_rejected(path), "BDF 256 pixel wide glyphs accepted");
+
+    /* binary font files go to console_font_load, anything else is rejected */
+    console_font_save(builtin, path);
+    font = console_font_open(path);
+    test_check(font && !memcmp(font->font_bitmap, builtin->font_bitmap, charsize), "font file not opened");
+    console_font_free(font);
+    test_write_text(path, "not a font\n");
+    test_check(test_rejected(path), "unknown format accepted");
+
+    unlink(path);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/*
+ * test-font-registry: fonts are found under their names until they are
+ * unregistered, whether or not they have a release function, the release
+ * function runs once the last console lets go of the font, and built-in
+ * fonts can't be unregistered.
+ */
+#include "console.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int g_failures;
+static int g_released;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_release(font_t * font) {
+    ++g_released;
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+int main(void) {
+    const font_t * builtin = &console_fonts[FONT_8x16];
+    font_t plain = *builtin;
+    font_t owned = *builtin;
+    const font_t * font;
+    plain.font_name = "test-plain";
+    owned.font_name = "test-owned";
+
+    /* without a release function */
+    test_check(console_font_register(&plain, NULL) == 0, "registering without release failed");
+    test_check(console_font_register(&plain, NULL) < 0 && errno == EEXIST, "registered twice");
+    font = console_font_lookup("test-plain");
+    test_check(font == &plain, "lookup did not find the font");
+    console_font_release(font);
+    test_check(console_font_unregister("test-plain") == 0, "font without release can't be unregistered");
+    test_check(console_font_lookup("test-plain") == NULL, "unregistered font still found");
+    test_check(console_font_unregister("test-plain") < 0 && errno == ENOENT, "unregistered twice");
+
+    /* with a release function, held by a console */
+    test_check(console_font_register(&owned, test_release) == 0, "registering with release failed");
+    console_t console = console_alloc(320, 160, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    font = console_font_lookup("test-owned");
+    console_set_font_data(console, font);
+    console_font_release(font);
+    test_check(console_font_unregister("test-owned") == 0, "font with release can't be unregistered");
+    test_check(g_released == 0, "font released while a console uses it");
+    console_set_font(console, FONT_8x16);
+    test_check(g_released == 1, "font not released once the console let go of it");
+    console_free(console);
+
+    /* built-in fonts stay */
+    test_check(console_font_unregister(builtin->font_name) < 0 && errno == EPERM, "built-in font unregistered");
+    font = console_font_lookup_size(builtin->char_width, builtin->char_height);
+    test_check(font == builtin, "size lookup did not prefer the built-in font");
+    console_font_release(font);
+
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+/*
+ * test-gray: MONO1, GRAY2 and GRAY4 pixels hold the gray level of the
+ * palette entry INDEX8 renders at the same spot, packed MSB first, by
+ * threshold or 4x4 ordered dither, with cells starting mid byte.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 10 pixel wide cells start at every even bit offset of a byte */
+#define TEST_WIDTH 170
+#define TEST_HEIGHT 80
+
+static int g_failures;
+
+static const unsigned char g_bayer4[4][4] = {
+    { 0, 8, 2, 10 },
+    { 12, 4, 14, 6 },
+    { 3, 11, 1, 9 },
+    { 15, 7, 13, 5 }
+};
+
+static const char g_text[] = "\x1b[1;31mgray\x1b[0m \x1b[42;35mlevels\x1b[0m\r\n\x1b[47;30m 0123 \x1b[46;33m#@\x1b[0m";
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static unsigned test_level(const console_rgb_t * c, unsigned bits, console_gray_mode mode,
+        unsigned threshold, unsigned x, unsigned y) {
+    unsigned luma = (c->r * 299 + c->g * 587 + c->b * 114 + 500) / 1000;
+    unsigned levels = 1u << bits;
+    if(mode == CONSOLE_GRAY_THRESHOLD)
+        return levels == 2 ? luma >= threshold : (luma * (levels - 1) + 127) / 255;
+    unsigned scaled = luma * (levels - 1);
+    return scaled / 255 + ((scaled % 255) * 16 / 255 > g_bayer4[y & 3][x & 3]);
+}
+
+int main(void) {
+    static const console_pixel_format formats[] = { CONSOLE_PIXEL_MONO1, CONSOLE_PIXEL_GRAY2, CONSOLE_PIXEL_GRAY4 };
+    static const unsigned bits[] = { 1, 2, 4 };
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    unsigned char * index = malloc(TEST_WIDTH * TEST_HEIGHT);
+    unsigned char * packed = malloc(TEST_WIDTH * TEST_HEIGHT);
+    char what[80];
+    unsigned f, x, y;
+    int mode;
+
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_10x20);
+    console_set_callback(console, test_callback, NULL);
+    console_set_mode(console, CONSOLE_MODE_ANSI);
+    console_get_palette(console, palette);
+    console_write(console, (const unsigned char *)g_text, sizeof(g_text) - 1);
+    console_cursor_goto_xy(console, 3, 2);
+    console_write(console, (const unsigned char *)"\x1b[44;37modd", 11);
+    console_render(console, index, TEST_WIDTH, CONSOLE_PIXEL_INDEX8);
+
+    for(mode = CONSOLE_GRAY_THRESHOLD; mode <= CONSOLE_GRAY_DITHER; ++mode) {
+        unsigned threshold = mode == CONSOLE_GRAY_THRESHOLD ? 100 : 128;
+        console_set_gray_mode(console, (console_gray_mode)mode, (unsigned char)threshold);
+        for(f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+            size_t stride = (TEST_WIDTH * bits[f] + 7) / 8;
+            bool same = true;
+            memset(packed, 0, TEST_WIDTH * TEST_HEIGHT);
+            console_render(console, packed, stride, formats[f]);
+            for(y = 0; y < TEST_HEIGHT && same; ++y) {
+                for(x = 0; x < TEST_WIDTH && same; ++x) {
+                    unsigned bit = x * bits[f];
+                    unsigned level = (packed[y * stride + bit / 8] >> (8 - bits[f] - bit % 8)) & ((1u << bits[f]) - 1);
+                    same = level == test_level(&palette[index[y * TEST_WIDTH + x]], bits[f],
+                            (console_gray_mode)mode, threshold, x, y);
+                }
+            }
+            snprintf(what, sizeof(what), "mode %d format %d: wrong level at %u,%u", mode, formats[f],
+                    x - 1, y - 1);
+            test_check(same, what);
+        }
+    }
+
+    console_free(console);
+    free(index);
+    free(packed);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/*
+ * test-group: a console group runs each console's drain, render function
+ * and flush on its pool threads only, removing a console waits for that
+ * console alone without running anyone's work on the caller, and a removed
+ * console is no longer run.
+ */
+#include "console.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct test_console {
+    console_t console;
+    _Atomic unsigned renders;
+    _Atomic bool on_caller;     /* a callback ran on the main thread */
+    unsigned sleep_ms;
+};
+
+static pthread_t g_main;
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+    struct test_console * t = data;
+    if(pthread_equal(pthread_self(), g_main))
+        atomic_store(&t->on_caller, true);
+}
+
+static void test_render(console_t console, void * data) {
+    struct test_console * t = data;
+    if(pthread_equal(pthread_self(), g_main))
+        atomic_store(&t->on_caller, true);
+    if(console_queue_pending(console) != 0)
+        fprintf(stderr, "render function ran before the queue was drained\n");
+    if(t->sleep_ms) {
+        struct timespec ts = { 0, (long)t->sleep_ms * 1000000 };
+        nanosleep(&ts, NULL);
+    }
+    atomic_fetch_add(&t->renders, 1);
+}
+
+static void test_init(struct test_console * t, console_group_t group, unsigned sleep_ms) {
+    t->console = console_alloc(320, 160, FONT_8x16);
+    atomic_init(&t->renders, 0);
+    atomic_init(&t->on_caller, false);
+    t->sleep_ms = sleep_ms;
+    console_set_callback(t->console, test_callback, t);
+    console_set_deferred_updates(t->console, true);
+    console_set_queue_size(t->console, 4096);
+    console_group_add(group, t->console, test_render, t);
+}
+
+int main(void) {
+    struct test_console slow, queued;
+    g_main = pthread_self();
+
+    /* one worker, busy with slow while queued waits in its deque */
+    console_group_t group = console_group_alloc(1);
+    test_init(&slow, group, 50);
+    test_init(&queued, group, 0);
+    console_enqueue(slow.console, (const unsigned char *)"slow\n", 5);
+    console_schedule(slow.console);
+    console_enqueue(queued.console, (const unsigned char *)"queued\n", 7);
+    console_schedule(queued.console);
+    console_group_remove(group, queued.console);
+    test_check(atomic_load(&queued.renders) == 1, "removed console's scheduled work did not run");
+    test_check(!atomic_load(&queued.on_caller), "remove ran the console's work on the caller");
+    test_check(console_get_character_at(queued.console, 0, 0) == 'q', "removed console was not drained");
+
+    /* scheduling a removed console does nothing */
+    console_enqueue(queued.console, (const unsigned char *)"again\n", 6);
+    console_schedule(queued.console);
+    console_group_wait(group);
+    test_check(atomic_load(&queued.renders) == 1, "removed console ran again");
+    test_check(atomic_load(&slow.renders) == 1, "render function did not run once");
+    test_check(!atomic_load(&slow.on_caller), "group work ran on the caller");
+
+    console_group_free(group);
+    console_free(slow.console);
+    console_free(queued.console);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
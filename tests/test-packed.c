@@ -0,0 +1,59 @@
+/*
+ * test-packed: rendering from bit-packed glyphs gives the same pixels as
+ * rendering from byte padded ones, for every font, rotation and pixel
+ * format, with and without the tile cache.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_SIZE 400
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+int main(void) {
+    size_t stride = TEST_SIZE * 4, size = stride * TEST_SIZE;
+    unsigned char * padded = malloc(size);
+    unsigned char * packed = malloc(size);
+    char what[96];
+    int font, rotation, format, cached;
+    for(font = 0; font < CONSOLE_NUM_FONTS; ++font) {
+        console_t console = console_alloc(TEST_SIZE, TEST_SIZE, (font_id_t)font);
+        unsigned i;
+        console_set_callback(console, test_callback, NULL);
+        for(i = 0; i < 2000; ++i)
+            console_print_char(console, (unsigned char)(i * 7 + 3));
+        for(rotation = CONSOLE_ROTATE_0; rotation <= CONSOLE_ROTATE_270; ++rotation) {
+            console_set_rotation(console, (console_rotation)rotation);
+            for(format = 0; format < CONSOLE_PIXEL_FORMAT_COUNT; ++format) {
+                for(cached = 0; cached < 2; ++cached) {
+                    console_set_tile_cache_size(console, cached ? CONSOLE_TILE_CACHE_DEFAULT_SIZE : 0);
+                    memset(padded, 0, size);
+                    memset(packed, 0, size);
+                    console_set_packed_glyphs(console, false);
+                    console_render(console, padded, stride, (console_pixel_format)format);
+                    console_set_packed_glyphs(console, true);
+                    console_render(console, packed, stride, (console_pixel_format)format);
+                    snprintf(what, sizeof(what), "font %d rotation %d format %d%s: packed render differs",
+                            font, rotation, format, cached ? " cached" : "");
+                    test_check(!memcmp(padded, packed, size), what);
+                }
+            }
+        }
+        console_free(console);
+    }
+    free(padded);
+    free(packed);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/*
+ * test-palette: changing palette entries sends one PALETTE update with the
+ * changed bits, followed by ROWS updates covering exactly the cells drawn
+ * in a changed colour, the cursor cell included, so a client repainting
+ * them matches a full render. An unchanged palette is still announced.
+ */
+#include "console.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 80x30 cells of 8x16 */
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+#define TEST_MAX_ROWS 64
+
+struct test_client {
+    unsigned palettes;
+    unsigned short changed;
+    unsigned rows;
+    unsigned rect[TEST_MAX_ROWS][4];
+};
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+    struct test_client * client = data;
+    if(u->type == CONSOLE_UPDATE_PALETTE) {
+        ++client->palettes;
+        client->changed = u->data.u_palette.changed;
+    } else if(u->type == CONSOLE_UPDATE_ROWS && client->rows < TEST_MAX_ROWS) {
+        unsigned * r = client->rect[client->rows++];
+        r[0] = u->data.u_rows.x1;
+        r[1] = u->data.u_rows.y1;
+        r[2] = u->data.u_rows.x2;
+        r[3] = u->data.u_rows.y2;
+    }
+}
+
+static bool test_rect(const struct test_client * client, unsigned i, unsigned x1, unsigned y1,
+        unsigned x2, unsigned y2) {
+    const unsigned * r = client->rect[i];
+    return i < client->rows && r[0] == x1 && r[1] == y1 && r[2] == x2 && r[3] == y2;
+}
+
+/* repaints the damage into pixels and compares with a full render */
+static bool test_repaint(console_t console, const struct test_client * client, uint32_t * pixels,
+        uint32_t * full) {
+    unsigned i;
+    for(i = 0; i < client->rows; ++i) {
+        const unsigned * r = client->rect[i];
+        console_render_rect(console, pixels, TEST_WIDTH * 4, CONSOLE_PIXEL_XRGB8888, r[0], r[1], r[2], r[3]);
+    }
+    console_render(console, full, TEST_WIDTH * 4, CONSOLE_PIXEL_XRGB8888);
+    return !memcmp(pixels, full, (size_t)TEST_WIDTH * TEST_HEIGHT * 4);
+}
+
+static void test_set_palette(console_t console, struct test_client * client, const console_rgb_t * palette) {
+    memset(client, 0, sizeof(*client));
+    console_set_palette(console, palette);
+}
+
+int main(void) {
+    struct test_client client;
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    uint32_t * pixels = malloc((size_t)TEST_WIDTH * TEST_HEIGHT * 4);
+    uint32_t * full = malloc((size_t)TEST_WIDTH * TEST_HEIGHT * 4);
+
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_8x16);
+    console_set_callback(console, test_callback, &client);
+    console_get_palette(console, palette);
+    /* cleared cells use entry 0 for both colours */
+    console_set_character_and_attribute_at(console, 5, 3, 'A', 0x1e);
+    console_set_character_and_attribute_at(console, 9, 4, 'B', 0x2e);
+    /* blank glyphs only show their background */
+    console_set_character_and_attribute_at(console, 2, 10, ' ', 0xe3);
+    console_set_character_and_attribute_at(console, 7, 12, ' ', 0x3e);
+    console_render(console, pixels, TEST_WIDTH * 4, CONSOLE_PIXEL_XRGB8888);
+
+    /* foreground of A and B, background of the first blank */
+    palette[14].r ^= 1;
+    test_set_palette(console, &client, palette);
+    test_check(client.palettes == 1 && client.changed == 1u << 14, "palette update missing or wrong bits");
+    test_check(client.rows == 2 && test_rect(&client, 0, 5, 3, 10, 5) && test_rect(&client, 1, 2, 10, 3, 11),
+            "damage not the cells drawn in the changed entry");
+    test_check(test_repaint(console, &client, pixels, full), "repainted damage differs from a full render");
+
+    /* nothing changed, announced without damage */
+    test_set_palette(console, &client, palette);
+    test_check(client.palettes == 1 && client.changed == 0 && client.rows == 0, "unchanged palette");
+
+    /* the shown cursor swaps the cell's colours */
+    console_set_character_and_attribute_at(console, 0, 0, 0xdb, 0x10);
+    console_cursor_goto_xy(console, 0, 0);
+    console_show_cursor(console);
+    while(!console_cursor_is_shown(console))
+        console_blink_cursor(console);
+    console_render(console, pixels, TEST_WIDTH * 4, CONSOLE_PIXEL_XRGB8888);
+    palette[1].r ^= 1;
+    test_set_palette(console, &client, palette);
+    test_check(client.rows >= 1 && client.rect[0][0] == 0 && client.rect[0][1] == 0, "cursor cell not damaged");
+    test_check(test_repaint(console, &client, pixels, full), "repainted cursor cell differs");
+    console_hide_cursor(console);
+    console_render(console, pixels, TEST_WIDTH * 4, CONSOLE_PIXEL_XRGB8888);
+
+    /* a blank's foreground isn't drawn */
+    palette[3].g ^= 1;
+    test_set_palette(console, &client, palette);
+    test_check(client.rows == 1 && test_rect(&client, 0, 7, 12, 8, 13), "blank foreground damaged");
+
+    /* deferred, the damage waits for the flush */
+    console_set_deferred_updates(console, true);
+    palette[0].b ^= 1;
+    test_set_palette(console, &client, palette);
+    test_check(client.palettes == 1 && client.rows == 0, "deferred palette damage sent early");
+    console_flush(console);
+    test_check(client.rows == 1 && test_rect(&client, 0, 0, 0, 80, 30), "deferred damage not flushed");
+    test_check(test_repaint(console, &client, pixels, full), "repainted deferred damage differs");
+
+    console_free(console);
+    free(pixels);
+    free(full);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/*
+ * test-pixel-format: every pixel of the 32 and 16 bit formats holds the
+ * palette color of the index INDEX8 renders at the same spot, packed as
+ * the format says.
+ */
+#include "console.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 160
+#define TEST_HEIGHT 64
+
+static int g_failures;
+
+static const char g_text[] = "\x1b[1;31mpixel\x1b[0m \x1b[42;35mformat\x1b[0m\r\n\x1b[47;30m 0123 \x1b[46;33m#@\x1b[0m";
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static uint32_t test_pixel(const console_rgb_t * c, console_pixel_format format) {
+    switch(format) {
+    case CONSOLE_PIXEL_XBGR8888:
+        return 0xff000000u | (uint32_t)c->b << 16 | (uint32_t)c->g << 8 | c->r;
+    case CONSOLE_PIXEL_BGRA8888:
+        return (uint32_t)c->b << 24 | (uint32_t)c->g << 16 | (uint32_t)c->r << 8 | 0xff;
+    case CONSOLE_PIXEL_RGB565:
+        return (uint32_t)(c->r >> 3) << 11 | (uint32_t)(c->g >> 2) << 5 | c->b >> 3;
+    default:
+        return 0xff000000u | (uint32_t)c->r << 16 | (uint32_t)c->g << 8 | c->b;
+    }
+}
+
+int main(void) {
+    static const console_pixel_format formats[] = {
+        CONSOLE_PIXEL_XRGB8888, CONSOLE_PIXEL_XBGR8888, CONSOLE_PIXEL_ARGB8888, CONSOLE_PIXEL_BGRA8888,
+        CONSOLE_PIXEL_RGB565
+    };
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    unsigned char * index = malloc(TEST_WIDTH * TEST_HEIGHT);
+    uint32_t * pixels = malloc(TEST_WIDTH * TEST_HEIGHT * 4);
+    char what[64];
+    unsigned i, f;
+
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    console_set_mode(console, CONSOLE_MODE_ANSI);
+    /* channels that differ in every bit position a format could mix up */
+    for(i = 0; i < CONSOLE_NUM_PALETTE_ENTRIES; ++i) {
+        palette[i].r = (unsigned char)(i * 17);
+        palette[i].g = (unsigned char)(255 - i * 13);
+        palette[i].b = (unsigned char)(i * 29 + 7);
+    }
+    console_set_palette(console, palette);
+    console_write(console, (const unsigned char *)g_text, sizeof(g_text) - 1);
+
+    console_render(console, index, TEST_WIDTH, CONSOLE_PIXEL_INDEX8);
+    bool valid = true, colors = false;
+    for(i = 0; i < TEST_WIDTH * TEST_HEIGHT; ++i) {
+        valid = valid && index[i] < CONSOLE_NUM_PALETTE_ENTRIES;
+        colors = colors || index[i] != index[0];
+    }
+    test_check(valid, "INDEX8 index outside the palette");
+    test_check(colors, "INDEX8 render has one color");
+
+    for(f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+        bool same = true;
+        if(formats[f] == CONSOLE_PIXEL_RGB565) {
+            uint16_t * p16 = (uint16_t *)pixels;
+            console_render(console, p16, TEST_WIDTH * 2, formats[f]);
+            for(i = 0; i < TEST_WIDTH * TEST_HEIGHT && same; ++i)
+                same = p16[i] == test_pixel(&palette[index[i]], formats[f]);
+        } else {
+            console_render(console, pixels, TEST_WIDTH * 4, formats[f]);
+            for(i = 0; i < TEST_WIDTH * TEST_HEIGHT && same; ++i)
+                same = pixels[i] == test_pixel(&palette[index[i]], formats[f]);
+        }
+        snprintf(what, sizeof(what), "format %d: pixels differ from the palette", formats[f]);
+        test_check(same, what);
+    }
+
+    console_free(console);
+    free(index);
+    free(pixels);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/*
+ * test-queue: a producer thread enqueues a byte stream through a small
+ * queue while the console drains it, first on the main thread, then from
+ * a console group. Afterwards the console must match one that was written
+ * the whole stream directly.
+ */
+#include "console.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_STREAM_SIZE (256 * 1024)
+#define TEST_QUEUE_SIZE 64
+
+struct test_producer {
+    console_t console;
+    const unsigned char * stream;
+    bool schedule;
+};
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static uint32_t test_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static console_t test_console(void) {
+    console_t console = console_alloc(320, 160, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    console_set_scrollback_rows(console, 100);
+    return console;
+}
+
+/* enqueues the stream in chunks of random size, spinning while the queue is full */
+static void * test_produce(void * arg) {
+    struct test_producer * producer = arg;
+    uint32_t state = 777;
+    size_t done = 0;
+    while(done < TEST_STREAM_SIZE) {
+        size_t len = 1 + test_random(&state) % (TEST_QUEUE_SIZE * 2);
+        if(len > TEST_STREAM_SIZE - done)
+            len = TEST_STREAM_SIZE - done;
+        size_t n = console_enqueue(producer->console, producer->stream + done, len);
+        done += n;
+        if(producer->schedule)
+            console_schedule(producer->console);
+        if(n < len)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static bool test_same(console_t a, console_t b) {
+    unsigned y, back;
+    size_t row_bytes = console_get_width(a) * sizeof(unsigned short);
+    if(console_get_cursor_x(a) != console_get_cursor_x(b) || console_get_cursor_y(a) != console_get_cursor_y(b))
+        return false;
+    if(console_get_scrollback_count(a) != console_get_scrollback_count(b))
+        return false;
+    for(y = 0; y < console_get_height(a); ++y) {
+        if(memcmp(console_get_view_row(a, y), console_get_view_row(b, y), row_bytes))
+            return false;
+    }
+    for(back = 1; back <= console_get_scrollback_count(a); ++back) {
+        if(memcmp(console_get_scrollback_row(a, back), console_get_scrollback_row(b, back), row_bytes))
+            return false;
+    }
+    return true;
+}
+
+int main(void) {
+    unsigned char * stream = malloc(TEST_STREAM_SIZE);
+    uint32_t state = 99;
+    int failures = 0;
+    size_t i;
+    for(i = 0; i < TEST_STREAM_SIZE; ++i) {
+        uint32_t r = test_random(&state) % 64;
+        stream[i] = r == 0 ? '\n' : r == 1 ? '\t' : (unsigned char)(' ' + r);
+    }
+
+    console_t reference = test_console();
+    console_write(reference, stream, TEST_STREAM_SIZE);
+
+    /* drained by the main thread */
+    console_t console = test_console();
+    console_set_queue_size(console, TEST_QUEUE_SIZE);
+    struct test_producer producer = { console, stream, false };
+    pthread_t thread;
+    pthread_create(&thread, NULL, test_produce, &producer);
+    size_t drained = 0;
+    while(drained < TEST_STREAM_SIZE) {
+        size_t n = console_drain(console, 1 + test_random(&state) % TEST_QUEUE_SIZE);
+        drained += n;
+        if(n == 0)
+            sched_yield();
+    }
+    pthread_join(thread, NULL);
+    if(console_queue_pending(console) != 0 || !test_same(console, reference)) {
+        fprintf(stderr, "drain: console differs from the reference\n");
+        ++failures;
+    }
+    console_free(console);
+
+    /* drained by a group as the producer schedules it */
+    console_group_t group = console_group_alloc(2);
+    console = test_console();
+    console_set_queue_size(console, TEST_QUEUE_SIZE);
+    console_group_add(group, console, NULL, NULL);
+    producer.console = console;
+    producer.schedule = true;
+    pthread_create(&thread, NULL, test_produce, &producer);
+    pthread_join(thread, NULL);
+    console_group_wait(group);
+    if(console_queue_pending(console) != 0 || !test_same(console, reference)) {
+        fprintf(stderr, "group: console differs from the reference\n");
+        ++failures;
+    }
+    console_group_free(group);
+    console_free(console);
+
+    console_free(reference);
+    free(stream);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
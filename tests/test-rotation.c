@@ -0,0 +1,91 @@
+/*
+ * test-rotation: a rotated render gives the pixels of the unrotated render
+ * turned clockwise, at scale 1 and 2, in the byte sized pixel formats.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 160
+#define TEST_HEIGHT 96
+
+static int g_failures;
+
+static const char g_text[] = "\x1b[1;31mrotate\x1b[0m \x1b[44mtest\x1b[0m\r\nLq|_/\\ 0123456789";
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+/* where unrotated pixel x, y lands in the rotated framebuffer */
+static void test_rotate(console_rotation rotation, unsigned x, unsigned y, unsigned * rx, unsigned * ry) {
+    switch(rotation) {
+    case CONSOLE_ROTATE_90:
+        *rx = TEST_HEIGHT - 1 - y;
+        *ry = x;
+        break;
+    case CONSOLE_ROTATE_180:
+        *rx = TEST_WIDTH - 1 - x;
+        *ry = TEST_HEIGHT - 1 - y;
+        break;
+    case CONSOLE_ROTATE_270:
+        *rx = y;
+        *ry = TEST_WIDTH - 1 - x;
+        break;
+    default:
+        *rx = x;
+        *ry = y;
+        break;
+    }
+}
+
+int main(void) {
+    static const console_pixel_format formats[] = {
+        CONSOLE_PIXEL_XRGB8888, CONSOLE_PIXEL_RGB565, CONSOLE_PIXEL_INDEX8
+    };
+    static const unsigned bytes[] = { 4, 2, 1 };
+    unsigned char * upright = calloc(TEST_WIDTH * TEST_HEIGHT, 4);
+    unsigned char * rotated = calloc(TEST_WIDTH * TEST_HEIGHT, 4);
+    char what[80];
+    unsigned scale, f, x, y, rx, ry;
+    int rotation;
+    for(scale = 1; scale <= 2; ++scale) {
+        console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_8x16);
+        console_set_callback(console, test_callback, NULL);
+        console_set_font_scale(console, scale);
+        console_set_mode(console, CONSOLE_MODE_ANSI);
+        console_write(console, (const unsigned char *)g_text, sizeof(g_text) - 1);
+        for(rotation = CONSOLE_ROTATE_90; rotation <= CONSOLE_ROTATE_270; ++rotation) {
+            bool sideways = rotation != CONSOLE_ROTATE_180;
+            for(f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+                unsigned px = bytes[f];
+                size_t stride = TEST_WIDTH * px, rotated_stride = (sideways ? TEST_HEIGHT : TEST_WIDTH) * px;
+                console_set_rotation(console, CONSOLE_ROTATE_0);
+                console_render(console, upright, stride, formats[f]);
+                console_set_rotation(console, (console_rotation)rotation);
+                console_render(console, rotated, rotated_stride, formats[f]);
+                bool same = true;
+                for(y = 0; y < TEST_HEIGHT && same; ++y) {
+                    for(x = 0; x < TEST_WIDTH && same; ++x) {
+                        test_rotate((console_rotation)rotation, x, y, &rx, &ry);
+                        same = !memcmp(upright + y * stride + x * px, rotated + ry * rotated_stride + rx * px, px);
+                    }
+                }
+                snprintf(what, sizeof(what), "scale %u rotation %d format %d: not the turned render",
+                        scale, rotation, formats[f]);
+                test_check(same, what);
+            }
+        }
+        console_free(console);
+    }
+    free(upright);
+    free(rotated);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/*
+ * test-scale: a console rendered at a font scale gives the pixels of the
+ * same console rendered at scale 1 with every pixel repeated scale times
+ * in both directions, in the byte sized pixel formats.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 96
+#define TEST_HEIGHT 64
+
+static int g_failures;
+
+static const char g_text[] = "\x1b[1;31mscale\x1b[0m \x1b[44mtest\x1b[0m\r\n0123456789 !@#$%^&*()";
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static console_t test_console(unsigned scale) {
+    console_t console = console_alloc(TEST_WIDTH * scale, TEST_HEIGHT * scale, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    console_set_font_scale(console, scale);
+    console_set_mode(console, CONSOLE_MODE_ANSI);
+    console_write(console, (const unsigned char *)g_text, sizeof(g_text) - 1);
+    return console;
+}
+
+int main(void) {
+    static const console_pixel_format formats[] = {
+        CONSOLE_PIXEL_XRGB8888, CONSOLE_PIXEL_RGB565, CONSOLE_PIXEL_INDEX8
+    };
+    static const unsigned bytes[] = { 4, 2, 1 };
+    console_t base = test_console(1);
+    unsigned char * small = calloc(TEST_WIDTH * TEST_HEIGHT, 4);
+    unsigned char * big = calloc((size_t)TEST_WIDTH * TEST_HEIGHT * CONSOLE_MAX_FONT_SCALE * CONSOLE_MAX_FONT_SCALE, 4);
+    char what[64];
+    unsigned scale, f, x, y;
+    for(scale = 2; scale <= CONSOLE_MAX_FONT_SCALE; ++scale) {
+        console_t console = test_console(scale);
+        test_check(console_get_width(console) == console_get_width(base) &&
+                console_get_height(console) == console_get_height(base), "scaled grid differs");
+        for(f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+            unsigned px = bytes[f];
+            size_t small_stride = TEST_WIDTH * px, big_stride = small_stride * scale;
+            console_render(base, small, small_stride, formats[f]);
+            console_render(console, big, big_stride, formats[f]);
+            bool same = true;
+            for(y = 0; y < TEST_HEIGHT * scale && same; ++y)
+                for(x = 0; x < TEST_WIDTH * scale && same; ++x)
+                    same = !memcmp(big + y * big_stride + x * px,
+                            small + y / scale * small_stride + x / scale * px, px);
+            snprintf(what, sizeof(what), "scale %u format %d: not the upscaled render", scale, formats[f]);
+            test_check(same, what);
+        }
+        console_free(console);
+    }
+    console_free(base);
+    free(small);
+    free(big);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/*
+ * test-scrollback: rows scrolled off the top land in the scrollback ring,
+ * newest first, up to a limit in rows or bytes, and the view offset shows
+ * them above the live screen until new output snaps the view back.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+/* the number printed at the start of a row, -1 if there is none */
+static int test_line(const unsigned short * row) {
+    char text[12];
+    unsigned i;
+    if(!row)
+        return -1;
+    for(i = 0; i < sizeof(text) - 1; ++i)
+        text[i] = (char)(row[i] & 0xff);
+    text[i] = 0;
+    return strncmp(text, "line ", 5) ? -1 : atoi(text + 5);
+}
+
+static void test_print(console_t console, unsigned first, unsigned count) {
+    char text[32];
+    unsigned i;
+    for(i = first; i < first + count; ++i) {
+        int n = snprintf(text, sizeof(text), "\r\nline %u", i);
+        console_write(console, (const unsigned char *)text, (size_t)n);
+    }
+}
+
+int main(void) {
+    console_t console = console_alloc(320, 160, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    unsigned height = console_get_height(console);
+    unsigned i;
+
+    /* limited in rows, oldest rows drop out */
+    console_set_scrollback_rows(console, 8);
+    test_check(console_get_scrollback_capacity(console) == 8, "row capacity");
+    test_print(console, 0, 30);
+    int top = test_line(console_get_view_row(console, 0));
+    test_check(top > 0, "screen not scrolled");
+    test_check(console_get_scrollback_count(console) == 8, "scrollback not full");
+    for(i = 1; i <= 8; ++i)
+        test_check(test_line(console_get_scrollback_row(console, i)) == top - (int)i, "scrollback row out of order");
+    test_check(console_get_scrollback_row(console, 0) == NULL, "row 0 is the live screen");
+    test_check(console_get_scrollback_row(console, 9) == NULL, "row past the count");
+
+    /* the view shows history above the screen, clamped to what is there */
+    console_set_view_offset(console, 3);
+    test_check(console_get_view_offset(console) == 3, "view offset not set");
+    test_check(test_line(console_get_view_row(console, 0)) == top - 3, "view row 0 not from the scrollback");
+    test_check(test_line(console_get_view_row(console, 3)) == top, "view row 3 not the screen's first");
+    test_check(console_get_view_row(console, height) == NULL, "view row past the height");
+    console_set_view_offset(console, 100);
+    test_check(console_get_view_offset(console) == 8, "view offset not clamped");
+    test_print(console, 30, 1);
+    test_check(console_get_view_offset(console) == 0, "output did not snap the view back");
+
+    console_clear_scrollback(console);
+    test_check(console_get_scrollback_count(console) == 0, "scrollback not cleared");
+    test_check(console_get_scrollback_row(console, 1) == NULL, "cleared row still there");
+
+    /* limited in bytes, rows of 40 cells */
+    console_set_scrollback_bytes(console, console_get_width(console) * sizeof(unsigned short) * 5 + 1);
+    test_check(console_get_scrollback_capacity(console) == 5, "byte capacity");
+    test_print(console, 100, 20);
+    top = test_line(console_get_view_row(console, 0));
+    test_check(console_get_scrollback_count(console) == 5, "byte limited scrollback not full");
+    test_check(test_line(console_get_scrollback_row(console, 5)) == top - 5, "oldest byte limited row");
+
+    /* no limit, no scrollback */
+    console_set_scrollback_rows(console, 0);
+    test_print(console, 200, 20);
+    test_check(console_get_scrollback_count(console) == 0, "scrollback without capacity");
+
+    console_free(console);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
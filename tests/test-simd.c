@@ -0,0 +1,217 @@
+/*
+ * test-simd: checks every SIMD kernel the running CPU supports against its
+ * scalar kernel, for every tail length up to a few vectors.
+ *
+ * simd.c is included so its static kernels can be called directly.
+ */
+#include "../src/simd.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAX_WIDTH 80
+#define TEST_MAX_SCALE 4
+#define TEST_CANARY 0xa5
+
+static int g_failures;
+
+static void test_fail(const char * kernel, const char * what, size_t n) {
+    fprintf(stderr, "%s: %s at length %zu\n", kernel, what, n);
+    ++g_failures;
+}
+
+#ifdef CONSOLE_SIMD_X86
+
+static uint32_t test_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void test_fill_random(unsigned char * buf, size_t len, uint32_t * state) {
+    size_t i;
+    for(i = 0; i < len; ++i)
+        buf[i] = (unsigned char)test_random(state);
+}
+
+/* the bytes past the n written by a kernel must keep the canary */
+static bool test_canary_intact(const unsigned char * buf, size_t from, size_t size) {
+    size_t i;
+    for(i = from; i < size; ++i) {
+        if(buf[i] != TEST_CANARY)
+            return false;
+    }
+    return true;
+}
+
+static void test_expand_32(const char * name, console_expand_row_32_t kernel) {
+    unsigned char src[(TEST_MAX_WIDTH + 7) / 8];
+    uint32_t want[TEST_MAX_WIDTH + 8], got[TEST_MAX_WIDTH + 8];
+    uint32_t state = 1;
+    unsigned width;
+    for(width = 0; width <= TEST_MAX_WIDTH; ++width) {
+        test_fill_random(src, sizeof(src), &state);
+        memset(want, TEST_CANARY, sizeof(want));
+        memset(got, TEST_CANARY, sizeof(got));
+        console_expand_row_32_scalar(want, src, width, 0x00ff8000, 0x00102030);
+        kernel(got, src, width, 0x00ff8000, 0x00102030);
+        if(memcmp(want, got, width * sizeof(*got)))
+            test_fail(name, "pixels differ", width);
+        if(!test_canary_intact((unsigned char *)got, width * sizeof(*got), sizeof(got)))
+            test_fail(name, "wrote past the row", width);
+    }
+}
+
+static void test_expand_16(const char * name, console_expand_row_16_t kernel) {
+    unsigned char src[(TEST_MAX_WIDTH + 7) / 8];
+    uint16_t want[TEST_MAX_WIDTH + 8], got[TEST_MAX_WIDTH + 8];
+    uint32_t state = 2;
+    unsigned width;
+    for(width = 0; width <= TEST_MAX_WIDTH; ++width) {
+        test_fill_random(src, sizeof(src), &state);
+        memset(want, TEST_CANARY, sizeof(want));
+        memset(got, TEST_CANARY, sizeof(got));
+        console_expand_row_16_scalar(want, src, width, 0xf800, 0x001f);
+        kernel(got, src, width, 0xf800, 0x001f);
+        if(memcmp(want, got, width * sizeof(*got)))
+            test_fail(name, "pixels differ", width);
+        if(!test_canary_intact((unsigned char *)got, width * sizeof(*got), sizeof(got)))
+            test_fail(name, "wrote past the row", width);
+    }
+}
+
+static void test_expand_8(const char * name, console_expand_row_8_t kernel) {
+    unsigned char src[(TEST_MAX_WIDTH + 7) / 8];
+    uint8_t want[TEST_MAX_WIDTH + 16], got[TEST_MAX_WIDTH + 16];
+    uint32_t state = 3;
+    unsigned width;
+    for(width = 0; width <= TEST_MAX_WIDTH; ++width) {
+        test_fill_random(src, sizeof(src), &state);
+        memset(want, TEST_CANARY, sizeof(want));
+        memset(got, TEST_CANARY, sizeof(got));
+        console_expand_row_8_scalar(want, src, width, 12, 3);
+        kernel(got, src, width, 12, 3);
+        if(memcmp(want, got, width))
+            test_fail(name, "pixels differ", width);
+        if(!test_canary_intact(got, width, sizeof(got)))
+            test_fail(name, "wrote past the row", width);
+    }
+}
+
+static void test_expand_32_scaled(const char * name, console_expand_row_32_scaled_t kernel) {
+    unsigned char src[(TEST_MAX_WIDTH + 7) / 8];
+    uint32_t want[TEST_MAX_WIDTH * TEST_MAX_SCALE + 8], got[TEST_MAX_WIDTH * TEST_MAX_SCALE + 8];
+    uint32_t state = 4;
+    unsigned width, scale;
+    for(scale = 1; scale <= TEST_MAX_SCALE; ++scale) {
+        for(width = 0; width <= TEST_MAX_WIDTH; ++width) {
+            size_t n = (size_t)width * scale;
+            test_fill_random(src, sizeof(src), &state);
+            memset(want, TEST_CANARY, sizeof(want));
+            memset(got, TEST_CANARY, sizeof(got));
+            console_expand_row_32_scaled_scalar(want, src, width, scale, 0x00ff8000, 0x00102030);
+            kernel(got, src, width, scale, 0x00ff8000, 0x00102030);
+            if(memcmp(want, got, n * sizeof(*got)))
+                test_fail(name, "pixels differ", n);
+            if(!test_canary_intact((unsigned char *)got, n * sizeof(*got), sizeof(got)))
+                test_fail(name, "wrote past the row", n);
+        }
+    }
+}
+
+/* every length, with the stop byte at every position and nowhere */
+static void test_scan(const char * name, console_scan_t scalar, console_scan_t kernel, unsigned char stop) {
+    unsigned char buf[TEST_MAX_WIDTH + 1];
+    size_t len, at, i;
+    for(len = 0; len <= TEST_MAX_WIDTH; ++len) {
+        for(at = 0; at <= len; ++at) {
+            /* printable bytes from both halves, which signed compares get wrong */
+            for(i = 0; i < sizeof(buf); ++i)
+                buf[i] = (unsigned char)(0x20 + i * 37 % 0xe0);
+            if(at < len)
+                buf[at] = stop;
+            /* a stop byte just past the end must not be seen */
+            buf[len] = stop;
+            if(kernel(buf, len) != scalar(buf, len))
+                test_fail(name, "run length differs", len);
+        }
+    }
+}
+
+static void test_store_cells(const char * name, console_store_cells_t kernel) {
+    unsigned char src[TEST_MAX_WIDTH];
+    unsigned char want[TEST_MAX_WIDTH * 2 + 32], got[TEST_MAX_WIDTH * 2 + 32];
+    uint32_t state = 5;
+    size_t n;
+    for(n = 0; n <= TEST_MAX_WIDTH; ++n) {
+        test_fill_random(src, sizeof(src), &state);
+        memset(want, TEST_CANARY, sizeof(want));
+        memset(got, TEST_CANARY, sizeof(got));
+        console_store_cells_scalar(want, src, n, 0x1e);
+        kernel(got, src, n, 0x1e);
+        if(memcmp(want, got, n * 2))
+            test_fail(name, "cells differ", n);
+        if(!test_canary_intact(got, n * 2, sizeof(got)))
+            test_fail(name, "wrote past the cells", n);
+    }
+}
+
+/* every length, with changes at every pair of first and last cells */
+static void test_diff_cells(const char * name, console_diff_cells_t kernel) {
+    uint16_t a[TEST_MAX_WIDTH], b[TEST_MAX_WIDTH];
+    size_t n, i, j;
+    for(n = 0; n <= TEST_MAX_WIDTH; ++n) {
+        size_t first = ~(size_t)0, last = ~(size_t)0;
+        for(i = 0; i < n; ++i)
+            a[i] = b[i] = (uint16_t)(0x0720 + i);
+        if(kernel(a, b, n, &first, &last) || first != ~(size_t)0 || last != ~(size_t)0)
+            test_fail(name, "reported a change in equal cells", n);
+        for(i = 0; i < n; ++i) {
+            for(j = i; j < n; ++j) {
+                size_t want_first = 0, want_last = 0;
+                memcpy(b, a, n * sizeof(*b));
+                b[i] ^= 0x0100;
+                b[j] ^= 0x0001;
+                console_diff_cells_scalar(a, b, n, &want_first, &want_last);
+                if(!kernel(a, b, n, &first, &last) || first != want_first || last != want_last)
+                    test_fail(name, "changed cells differ", n);
+            }
+        }
+    }
+}
+
+#endif /* CONSOLE_SIMD_X86 */
+
+int main(void) {
+#ifdef CONSOLE_SIMD_X86
+    int level = console_simd_level();
+    if(level >= SIMD_SSE2) {
+        test_expand_32("expand_row_32_sse2", console_expand_row_32_sse2);
+        test_expand_16("expand_row_16_sse2", console_expand_row_16_sse2);
+        test_expand_8("expand_row_8_sse2", console_expand_row_8_sse2);
+        test_expand_32_scaled("expand_row_32_scaled_sse2", console_expand_row_32_scaled_sse2);
+        test_scan("scan_printable_sse2", console_scan_printable_scalar, console_scan_printable_sse2, 0x1b);
+        test_scan("scan_text_sse2", console_scan_text_scalar, console_scan_text_sse2, '\n');
+        test_scan("scan_text_sse2", console_scan_text_scalar, console_scan_text_sse2, '\t');
+        test_store_cells("store_cells_sse2", console_store_cells_sse2);
+        test_diff_cells("diff_cells_sse2", console_diff_cells_sse2);
+    }
+    if(level >= SIMD_AVX2) {
+        test_expand_32("expand_row_32_avx2", console_expand_row_32_avx2);
+        test_scan("scan_printable_avx2", console_scan_printable_scalar, console_scan_printable_avx2, 0x1b);
+        test_scan("scan_text_avx2", console_scan_text_scalar, console_scan_text_avx2, '\n');
+        test_scan("scan_text_avx2", console_scan_text_scalar, console_scan_text_avx2, '\t');
+        test_diff_cells("diff_cells_avx2", console_diff_cells_avx2);
+    }
+    if(level == SIMD_NONE)
+        printf("no SIMD kernels to test\n");
+#else
+    printf("no SIMD kernels to test\n");
+#endif
+    /* the resolved kernels, whichever they are */
+    if(console_scan_printable((const unsigned char *)"abc\x1b", 4) != 3)
+        test_fail("scan_printable", "resolved kernel is wrong", 4);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/*
+ * test-snapshot: an acquired snapshot stays intact however often the
+ * writer publishes until it is released, acquiring again meanwhile returns
+ * the same snapshot, and after the release the newest one is acquired.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static unsigned char test_char(console_snapshot_t snapshot) {
+    return console_snapshot_get_row(snapshot, 0)[0] & 0xff;
+}
+
+static void test_publish(console_t console, const char * s) {
+    console_cursor_goto_xy(console, 0, 0);
+    console_write(console, (const unsigned char *)s, 1);
+    console_snapshot_publish(console);
+}
+
+int main(void) {
+    console_t console = console_alloc(320, 160, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    console_set_snapshots(console, true);
+    test_check(console_snapshot_acquire(console) == NULL, "snapshot before the first publish");
+
+    test_publish(console, "a");
+    console_snapshot_t first = console_snapshot_acquire(console);
+    test_check(first && test_char(first) == 'a', "first snapshot wrong");
+    uint64_t generation = first ? console_snapshot_get_generation(first) : 0;
+
+    /* enough publishes to cycle every other slot through the writer */
+    test_publish(console, "b");
+    console_snapshot_t nested = console_snapshot_acquire(console);
+    test_check(nested == first, "nested acquire returned another snapshot");
+    test_publish(console, "c");
+    test_publish(console, "d");
+    test_publish(console, "e");
+    test_check(test_char(first) == 'a' && console_snapshot_get_generation(first) == generation,
+            "held snapshot overwritten by the writer");
+    console_snapshot_release(console, nested);
+    test_publish(console, "f");
+    test_check(test_char(first) == 'a' && console_snapshot_get_generation(first) == generation,
+            "snapshot overwritten while still held once");
+    console_snapshot_release(console, first);
+
+    console_snapshot_t latest = console_snapshot_acquire(console);
+    test_check(latest && test_char(latest) == 'f', "newest snapshot not acquired after release");
+    test_check(latest && console_snapshot_get_generation(latest) > generation, "generation did not grow");
+    console_snapshot_release(console, latest);
+
+    console_free(console);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
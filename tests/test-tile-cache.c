@@ -0,0 +1,95 @@
+/*
+ * test-tile-cache: the tile cache keeps no more tiles than fit in its byte
+ * budget at any glyph size and scale, a budget below one tile caches
+ * nothing, and cached renders match uncached ones.
+ *
+ * Tiles are looked up directly, which needs the console's private API.
+ */
+#include "console.h"
+#include "console-private.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 480
+
+static int g_failures;
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+/* distinct tile slots handed out for every character in two attributes */
+static unsigned test_slots(console_t console) {
+    static const void * seen[512];
+    unsigned n = 0, i, j;
+    for(i = 0; i < 512; ++i) {
+        const void * tile = console_tile_cache_lookup(console, &console->tile_cache, i & 0xff, i >> 8,
+                CONSOLE_PIXEL_XRGB8888, 0xffffff, 0);
+        if(!tile)
+            continue;
+        for(j = 0; j < n && seen[j] != tile; ++j)
+            ;
+        if(j == n)
+            seen[n++] = tile;
+    }
+    console_tile_cache_invalidate(console);
+    return n;
+}
+
+static void test_budget(console_t console, unsigned scale) {
+    char what[96];
+    console_set_font_scale(console, scale);
+    size_t tile_bytes = (size_t)console->char_width * console->char_height * scale * scale * 4;
+    unsigned slots = test_slots(console);
+    snprintf(what, sizeof(what), "scale %u: %u tiles exceed the %zu byte budget", scale, slots,
+            console_get_tile_cache_size(console));
+    test_check(slots > 0 && slots * tile_bytes <= console_get_tile_cache_size(console), what);
+}
+
+static void test_render_equal(console_t console) {
+    size_t stride = TEST_WIDTH * 4;
+    uint32_t * cached = calloc(TEST_WIDTH * TEST_HEIGHT, 4);
+    uint32_t * uncached = calloc(TEST_WIDTH * TEST_HEIGHT, 4);
+    size_t size = console_get_tile_cache_size(console);
+    console_render(console, cached, stride, CONSOLE_PIXEL_XRGB8888);
+    console_render(console, cached, stride, CONSOLE_PIXEL_XRGB8888);
+    console_set_tile_cache_size(console, 0);
+    console_render(console, uncached, stride, CONSOLE_PIXEL_XRGB8888);
+    console_set_tile_cache_size(console, size);
+    test_check(!memcmp(cached, uncached, TEST_WIDTH * TEST_HEIGHT * 4), "cached render differs");
+    free(cached);
+    free(uncached);
+}
+
+int main(void) {
+    console_t console = console_alloc(TEST_WIDTH, TEST_HEIGHT, FONT_10x20);
+    console_set_callback(console, test_callback, NULL);
+    test_check(console_get_tile_cache_size(console) == CONSOLE_TILE_CACHE_DEFAULT_SIZE, "default size");
+
+    console_write(console, (const unsigned char *)"tile cache\nTILE CACHE\n0123456789", 32);
+    test_budget(console, 1);
+    test_budget(console, 4);
+    test_render_equal(console);
+
+    /* a smaller budget at the same scale keeps fewer tiles */
+    console_set_tile_cache_size(console, 64 * 1024);
+    test_budget(console, 2);
+    test_render_equal(console);
+
+    /* less than a tile caches nothing but still renders */
+    console_set_font_scale(console, 4);
+    console_set_tile_cache_size(console, (size_t)console->char_width * console->char_height * 16 * 4 - 1);
+    test_check(test_slots(console) == 0, "budget below one tile still cached");
+    test_render_equal(console);
+
+    console_free(console);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+/*
+ * test-write: console_write must leave a console exactly as feeding the
+ * same bytes one at a time through console_print_char does, in raw and
+ * ANSI mode, including across scrolls, wraps and split escape sequences.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_STEPS 3000
+
+static const char * const g_chunks[] = {
+    "hello", "world ", "\n", "\r", "\t", "\b", "abc\ndef\n\n", "\x7f", "\xc4\xe9",
+    "a long line of text that wraps around the right edge of the console more than once",
+    "\x1b[5;7H", "\x1b[2J", "\x1b[K", "\x1b[1;31m", "\x1b[0m", "\x1b[44m", "\x1b[M", "\x1b[3L",
+    "\x1b[S", "\x1b[T", "\x1b[10;4r", "\x1b[r", "\x1b[10B", "\x1b[?7l", "\x1b[?7h", "\x1b" "7", "\x1b" "8",
+    "\x1b[", "2;", "5H", "\x1b" "D", "\x1b" "M"
+};
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static uint32_t test_random(uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static console_t test_console(console_mode mode) {
+    console_t console = console_alloc(320, 160, FONT_8x16);
+    console_set_callback(console, test_callback, NULL);
+    console_set_mode(console, mode);
+    console_set_scrollback_rows(console, 50);
+    return console;
+}
+
+/* returns the first differing view cell as y * width + x, or -1 */
+static long test_compare(console_t a, console_t b) {
+    unsigned w = console_get_width(a);
+    unsigned h = console_get_height(a);
+    unsigned x, y, back;
+    if(console_get_cursor_x(a) != console_get_cursor_x(b) || console_get_cursor_y(a) != console_get_cursor_y(b))
+        return (long)w * h;
+    if(console_get_scrollback_count(a) != console_get_scrollback_count(b))
+        return (long)w * h + 1;
+    for(y = 0; y < h; ++y) {
+        const unsigned short * ra = console_get_view_row(a, y);
+        const unsigned short * rb = console_get_view_row(b, y);
+        for(x = 0; x < w; ++x) {
+            if(ra[x] != rb[x])
+                return (long)y * w + x;
+        }
+    }
+    for(back = 1; back <= console_get_scrollback_count(a); ++back) {
+        if(memcmp(console_get_scrollback_row(a, back), console_get_scrollback_row(b, back), w * sizeof(unsigned short)))
+            return (long)w * h + 2;
+    }
+    return -1;
+}
+
+static int test_mode(console_mode mode, const char * name) {
+    console_t whole = test_console(mode);
+    console_t bytes = test_console(mode);
+    uint32_t state = 12345;
+    int step, failures = 0;
+    for(step = 0; step < TEST_STEPS && failures < 10; ++step) {
+        unsigned char buf[512];
+        size_t len = 0, i;
+        unsigned k = 1 + test_random(&state) % 8;
+        while(k-- > 0) {
+            const char * s = g_chunks[test_random(&state) % (sizeof(g_chunks) / sizeof(g_chunks[0]))];
+            size_t l = strlen(s);
+            if(len + l <= sizeof(buf)) {
+                memcpy(buf + len, s, l);
+                len += l;
+            }
+        }
+        console_write(whole, buf, len);
+        for(i = 0; i < len; ++i)
+            console_print_char(bytes, buf[i]);
+        long cell = test_compare(whole, bytes);
+        if(cell >= 0) {
+            fprintf(stderr, "%s: step %d differs at %ld after '", name, step, cell);
+            fwrite(buf, 1, len, stderr);
+            fprintf(stderr, "'\n");
+            ++failures;
+            /* start both over so one difference is reported once */
+            console_free(bytes);
+            bytes = test_console(mode);
+            console_free(whole);
+            whole = test_console(mode);
+        }
+    }
+    console_free(whole);
+    console_free(bytes);
+    return failures;
+}
+
+int main(void) {
+    int failures = test_mode(CONSOLE_MODE_RAW, "raw");
+    failures += test_mode(CONSOLE_MODE_ANSI, "ansi");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
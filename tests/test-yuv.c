@@ -0,0 +1,130 @@
+/*
+ * test-yuv: I420 and NV12 luma holds the Y of the palette entry INDEX8
+ * renders at the same spot and every 2x2 chroma block the rounded mean of
+ * its pixels' U and V, for cells on even and odd pixels. Rendering one
+ * damaged cell gives the same planes as rendering everything again.
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ROWS 4
+#define TEST_COLUMNS 18
+
+static int g_failures;
+
+static const char g_text[] = "\x1b[1;31myuv\x1b[0m \x1b[42;35mplanes\x1b[0m\r\n\x1b[47;30m 0123 \x1b[46;33m#@\x1b[0m";
+
+struct test_planes {
+    unsigned char * y;
+    unsigned char * u;
+    unsigned char * v;
+    console_yuv_planes_t planes;
+};
+
+static void test_check(bool ok, const char * what) {
+    if(!ok) {
+        fprintf(stderr, "%s\n", what);
+        ++g_failures;
+    }
+}
+
+static void test_callback(console_t console, console_update_t * u, void * data) {
+}
+
+static void test_yuv(const console_rgb_t * c, unsigned char yuv[3]) {
+    int r = c->r, g = c->g, b = c->b;
+    yuv[0] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    yuv[1] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    yuv[2] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+static void test_planes_alloc(struct test_planes * p, console_yuv_format format, unsigned width, unsigned height) {
+    p->y = calloc(width, height);
+    p->u = calloc(width, height / 2);
+    p->v = calloc(width / 2, height / 2);
+    p->planes.y = p->y;
+    p->planes.y_stride = width;
+    p->planes.u = p->u;
+    p->planes.u_stride = format == CONSOLE_YUV_NV12 ? width : width / 2;
+    p->planes.v = p->v;
+    p->planes.v_stride = width / 2;
+}
+
+static void test_planes_free(struct test_planes * p) {
+    free(p->y);
+    free(p->u);
+    free(p->v);
+}
+
+static bool test_planes_equal(const struct test_planes * a, const struct test_planes * b, unsigned width,
+        unsigned height) {
+    return !memcmp(a->y, b->y, (size_t)width * height) && !memcmp(a->u, b->u, (size_t)width * height / 2) &&
+            !memcmp(a->v, b->v, (size_t)width * height / 4);
+}
+
+static void test_font(font_id_t font, console_yuv_format format) {
+    const font_t * data = &console_fonts[font];
+    unsigned width = data->char_width * TEST_COLUMNS, height = data->char_height * TEST_ROWS;
+    console_rgb_t palette[CONSOLE_NUM_PALETTE_ENTRIES];
+    unsigned char yuv[CONSOLE_NUM_PALETTE_ENTRIES][3];
+    unsigned char * index = malloc((size_t)width * height);
+    struct test_planes full, again;
+    char what[80];
+    unsigned i, x, y;
+
+    console_t console = console_alloc(width, height, font);
+    console_set_callback(console, test_callback, NULL);
+    console_set_mode(console, CONSOLE_MODE_ANSI);
+    console_get_palette(console, palette);
+    for(i = 0; i < CONSOLE_NUM_PALETTE_ENTRIES; ++i)
+        test_yuv(&palette[i], yuv[i]);
+    console_write(console, (const unsigned char *)g_text, sizeof(g_text) - 1);
+    console_render(console, index, width, CONSOLE_PIXEL_INDEX8);
+    test_planes_alloc(&full, format, width, height);
+    console_render_yuv(console, &full.planes, format);
+
+    bool same = true;
+    for(i = 0; i < width * height && same; ++i)
+        same = full.y[i] == yuv[index[i]][0];
+    snprintf(what, sizeof(what), "font %d format %d: luma differs from the palette", font, format);
+    test_check(same, what);
+
+    unsigned step = format == CONSOLE_YUV_NV12 ? 2 : 1;
+    for(y = 0; y < height / 2 && same; ++y) {
+        const unsigned char * u = full.planes.u + y * full.planes.u_stride;
+        const unsigned char * v = format == CONSOLE_YUV_NV12 ? u + 1 : full.planes.v + y * full.planes.v_stride;
+        for(x = 0; x < width / 2 && same; ++x) {
+            const unsigned char * p = index + (size_t)y * 2 * width + x * 2;
+            unsigned su = yuv[p[0]][1] + yuv[p[1]][1] + yuv[p[width]][1] + yuv[p[width + 1]][1];
+            unsigned sv = yuv[p[0]][2] + yuv[p[1]][2] + yuv[p[width]][2] + yuv[p[width + 1]][2];
+            same = u[x * step] == (su + 2) / 4 && v[x * step] == (sv + 2) / 4;
+        }
+    }
+    snprintf(what, sizeof(what), "font %d format %d: chroma not the block mean", font, format);
+    test_check(same, what);
+
+    /* one cell changed and rendered on its own */
+    console_cursor_goto_xy(console, 5, 2);
+    console_write(console, (const unsigned char *)"\x1b[41;37mZ", 9);
+    console_render_yuv_rect(console, &full.planes, format, 5, 2, 6, 3);
+    test_planes_alloc(&again, format, width, height);
+    console_render_yuv(console, &again.planes, format);
+    snprintf(what, sizeof(what), "font %d format %d: damaged cell render differs", font, format);
+    test_check(test_planes_equal(&full, &again, width, height), what);
+
+    test_planes_free(&full);
+    test_planes_free(&again);
+    free(index);
+    console_free(console);
+}
+
+int main(void) {
+    /* 8 pixel cells keep chroma blocks inside them, 9 pixel ones straddle */
+    test_font(FONT_8x16, CONSOLE_YUV_I420);
+    test_font(FONT_8x16, CONSOLE_YUV_NV12);
+    test_font(FONT_9x16, CONSOLE_YUV_I420);
+    test_font(FONT_9x16, CONSOLE_YUV_NV12);
+    return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+/*
+ * console-mkfont: write the built-in fonts out as binary font files that
+ * console_font_load() can map at run time.
+ *
+ * usage: console-mkfont [-f font_name] output_dir
+ */
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char ** argv) {
+    const char * only = NULL;
+    const char * dir = NULL;
+    int i;
+    for(i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "-f") && i + 1 < argc)
+            only = argv[++i];
+        else if(!dir)
+            dir = argv[i];
+        else
+            break;
+    }
+    if(!dir || i < argc) {
+        fprintf(stderr, "usage: %s [-f font_name] output_dir\n", argv[0]);
+        return 2;
+    }
+
+    int written = 0;
+    for(i = 0; i < CONSOLE_NUM_FONTS; ++i) {
+        const font_t * font = &console_fonts[i];
+        if(only && strcmp(only, font->font_name))
+            continue;
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%ux%u.cfnt", dir, font->char_width, font->char_height);
+        if(console_font_save(font, path) < 0) {
+            perror(path);
+            return 1;
+        }
+        ++written;
+    }
+    if(written == 0) {
+        fprintf(stderr, "%s: no font named %s\n", argv[0], only);
+        return 1;
+    }
+    return 0;
+}